@@ -18,26 +18,29 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/videoio.hpp>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
 #include <vector>
 #include <map>
 
 #include "coin_utils.h"
 #include "coin_detector.h"
+#include "coin_engine.h"
+#include "coin_log.h"
+#include "coin_pipeline.h"
+#include "coin_profile.h"
 
-int main(void) {
-    // Inicializar contagem de moedas
-    coinCount["1 centimo"] = 0;
-    coinCount["2 centimos"] = 0;
-    coinCount["5 centimos"] = 0;
-    coinCount["10 centimos"] = 0;
-    coinCount["20 centimos"] = 0;
-    coinCount["50 centimos"] = 0;
-    coinCount["1 euro"] = 0;
-    coinCount["2 euros"] = 0;
-    coinCount["Total Moedas"] = 0;
+extern "C" {
+#include "vc_simd.h"
+}
+
+// Modo interativo: um vídeo, mostrado numa janela com a deteção desenhada
+static int run_interactive(const char* videofile, const DetectorOptions& options) {
+    // Detector (seguimento e contagem de moedas) deste vídeo
+    CoinDetector detector(options);
 
     // Vídeo
-    char videofile[20] = "video1.mp4";
     cv::VideoCapture capture;
     struct
     {
@@ -46,7 +49,7 @@ int main(void) {
         int fps;
         int nframe;
     } video;
-    std::string str;
+    OverlayRenderer renderer;
     int key = 0;
 
     /* Leitura de vídeo de um ficheiro */
@@ -73,49 +76,75 @@ int main(void) {
     /* Inicia o timer */
     vc_timer();
 
-    cv::Mat frame;
+    // Leitura e detecção correm em threads próprias; aqui só se mostram os frames já processados
+    FramePipeline pipeline(capture, video.fps, detector);
+    pipeline.start();
+
     while (key != 'q') {
-        /* Leitura de uma frame do vídeo */
-        capture.read(frame);
-
-        /* Verifica se conseguiu ler a frame */
-        if (frame.empty()) break;
-
-        /* Número da frame a processar */
-        video.nframe = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
-
-        // Processamento da frame para detecção de moedas
-        detect_coins_in_frame(frame, video.nframe);
-
-        /* Exemplo de inserção texto na frame */
-        str = std::string("RESOLUCAO: ").append(std::to_string(video.width)).append("x").append(std::to_string(video.height));
-        cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-        cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-        str = std::string("TOTAL DE FRAMES: ").append(std::to_string(video.ntotalframes));
-        cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-        cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-        str = std::string("FRAME RATE: ").append(std::to_string(video.fps));
-        cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-        cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-        str = std::string("N. DA FRAME: ").append(std::to_string(video.nframe));
-        cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-        cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-
-        /* Exibe a frame */
-        cv::imshow("VC - VIDEO", frame);
-
-        /* Sai da aplicação, se o utilizador premir a tecla 'q' */
-        key = cv::waitKey(10);
+        /* Próxima frame já lida e processada (detecção de moedas) */
+        PipelineFrame* processed = pipeline.next();
+
+        /* Verifica se ainda há frames */
+        if (processed == NULL) break;
+
+        cv::Mat& frame = processed->image;
+
+        /* Número da frame processada */
+        video.nframe = processed->number;
+
+        /* Exemplo de inserção texto na frame (depois dos desenhos da deteção, se ainda estiverem por fazer) */
+        if (options.draw) {
+            Overlay& overlay = processed->overlay;
+
+            // Os três primeiros não mudam durante o vídeo: rasterizados só uma vez
+            overlay.text(cv::Point(20, 25), 1.0, cv::Scalar(0, 0, 0), 2, true, "RESOLUCAO: %dx%d", video.width, video.height);
+            overlay.text(cv::Point(20, 25), 1.0, cv::Scalar(255, 255, 255), 1, true, "RESOLUCAO: %dx%d", video.width, video.height);
+            overlay.text(cv::Point(20, 50), 1.0, cv::Scalar(0, 0, 0), 2, true, "TOTAL DE FRAMES: %d", video.ntotalframes);
+            overlay.text(cv::Point(20, 50), 1.0, cv::Scalar(255, 255, 255), 1, true, "TOTAL DE FRAMES: %d", video.ntotalframes);
+            overlay.text(cv::Point(20, 75), 1.0, cv::Scalar(0, 0, 0), 2, true, "FRAME RATE: %d", video.fps);
+            overlay.text(cv::Point(20, 75), 1.0, cv::Scalar(255, 255, 255), 1, true, "FRAME RATE: %d", video.fps);
+            overlay.text(cv::Point(20, 100), 1.0, cv::Scalar(0, 0, 0), 2, false, "N. DA FRAME: %d", video.nframe);
+            overlay.text(cv::Point(20, 100), 1.0, cv::Scalar(255, 255, 255), 1, false, "N. DA FRAME: %d", video.nframe);
+        }
+        {
+            PROFILE_SCOPE(PROFILE_RENDER);
+            renderer.render(processed->overlay, frame);
+        }
+        processed->overlay.clear();
+
+        {
+            PROFILE_SCOPE(PROFILE_DISPLAY);
+
+            /* Exibe a frame */
+            cv::imshow("VC - VIDEO", frame);
+
+            /* Sai da aplicação, se o utilizador premir a tecla 'q' (1 ms: só para processar os eventos da janela) */
+            key = cv::waitKey(1);
+        }
+
+        /* Tecla 'p': tempos por etapa até agora */
+        if (key == 'p') profile_dump(std::cerr);
+
+        pipeline.release(processed);
     }
 
+    pipeline.stop();
+
+    /* Mensagens das moedas ainda por escrever, antes dos resultados */
+    eventLog.flush();
+
     /* Para o timer e exibe o tempo decorrido */
     vc_timer();
 
+    if (pipeline.dropped() > 0) {
+        std::cout << "Frames descartados (detecção atrasada): " << pipeline.dropped() << std::endl;
+    }
+
     /* Exibe a contagem final de moedas */
     std::cout << "\n-- CONTAGEM FINAL DE MOEDAS --" << std::endl;
-    for (const auto& pair : coinCount) {
-        if (pair.second > 0) { // Só mostrar tipos que foram detectados
-            std::cout << pair.first << ": " << pair.second << std::endl;
+    for (int type = 0; type < (int)detector.counts().size(); type++) {
+        if (detector.counts()[type] > 0) { // Só mostrar tipos que foram detectados
+            std::cout << coin_name((CoinType)type) << ": " << detector.counts()[type] << std::endl;
         }
     }
 
@@ -126,4 +155,194 @@ int main(void) {
     capture.release();
 
     return 0;
+}
+
+// Modo sem janela (servidores): processa todos os vídeos em simultâneo, o mais depressa possível,
+// sem desenhar nem esperar por teclas, e escreve a contagem de cada um em out
+static int run_headless(const std::vector<const char*>& videofiles, DetectorOptions options, std::ostream& out) {
+    int errors = 0;
+
+    options.draw = false;
+
+    CoinEngine engine(options, options.threads);
+    for (const char* videofile : videofiles) engine.add_stream(videofile);
+    engine.run();
+    eventLog.flush();
+
+    for (const StreamResult& result : engine.results()) {
+        if (!result.opened) {
+            errors++;
+            continue;
+        }
+
+        out << "Video: " << result.source << std::endl;
+        out << "Frames: " << result.frames << std::endl;
+        if (result.dropped > 0) out << "Frames descartados: " << result.dropped << std::endl;
+        out << "Tempo: " << result.seconds << " segundos ("
+            << (result.seconds > 0 ? result.frames / result.seconds : 0) << " fps)" << std::endl;
+        for (int type = 0; type < N_COIN_TYPES; type++) {
+            out << coin_name((CoinType)type) << ": " << result.counts[type] << std::endl;
+        }
+        // Moedas contadas sem tipo, só quando as há
+        if (result.counts[COIN_UNKNOWN] > 0) {
+            out << coin_name(COIN_UNKNOWN) << ": " << result.counts[COIN_UNKNOWN] << std::endl;
+        }
+        out << "Total Moedas: " << result.total << std::endl << std::endl;
+    }
+
+    return errors > 0 ? 1 : 0;
+}
+
+static void usage(const char* program) {
+    std::cerr << "Uso: " << program << " [--no-overlay] [--overlay-on-display] [opções] [video]\n"
+        << "     " << program << " --headless [--output <ficheiro>] [--verbose] [opções] <video> [video ...]\n"
+        << "     " << program << " --simd-selftest\n"
+        << "Opções (nos dois modos): [--threads <n>] [--assignment] [--roi <n>] [--roi-edges <lrtb|->] [--changes] [--pyramid <2|4>]\n"
+        << "     [--validate-pyramid] [--drop-frames] [--profile] [--log <ficheiro>] [--log-format <text|json|binary>] [--log-level <debug|info|warn|error>]\n"
+        << "Sem argumentos abre video1.mp4 numa janela ('q' para sair).\n";
+}
+
+int main(int argc, char** argv) {
+    DetectorOptions options;
+    bool headless = false;
+    bool verbose = false;
+    bool profile = false;
+    const char* roiEdges = NULL;
+    const char* output = NULL;
+    const char* logfile = NULL;
+    LogFormat logFormat = LOG_TEXT;
+    LogLevel logLevel = LOG_DEBUG;
+    std::vector<const char*> videofiles;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--assignment") == 0) {
+            options.assignmentTracker = true;
+        }
+        else if (strcmp(argv[i], "--roi") == 0 && i + 1 < argc) {
+            options.roiTracking = true;
+            options.roiFullFrameInterval = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--roi-edges") == 0 && i + 1 < argc) {
+            roiEdges = argv[++i];
+        }
+        else if (strcmp(argv[i], "--changes") == 0) {
+            options.changeGating = true;
+        }
+        else if (strcmp(argv[i], "--pyramid") == 0 && i + 1 < argc) {
+            options.pyramidFactor = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--validate-pyramid") == 0) {
+            options.validatePyramid = true;
+        }
+        else if (strcmp(argv[i], "--no-overlay") == 0) {
+            options.draw = false;
+        }
+        else if (strcmp(argv[i], "--overlay-on-display") == 0) {
+            pipelineOptions.overlayOnDisplay = true;
+        }
+        else if (strcmp(argv[i], "--drop-frames") == 0) {
+            pipelineOptions.dropFrames = true;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        }
+        else if (strcmp(argv[i], "--simd-selftest") == 0) {
+            // Kernels vetoriais contra os escalares; o código de saída é o número de kernels diferentes
+            int failures = vc_simd_selftest();
+            std::cout << "Teste SIMD (" << vc_simd_name(vc_simd_detect()) << "): ";
+            if (failures == 0) std::cout << "todos os kernels iguais aos escalares" << std::endl;
+            else std::cout << failures << " kernels com diferenças" << std::endl;
+            return failures;
+        }
+        else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            logfile = argv[++i];
+            verbose = true;
+        }
+        else if (strcmp(argv[i], "--log-format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "json") == 0) logFormat = LOG_JSON;
+            else if (strcmp(argv[i], "binary") == 0) logFormat = LOG_BINARY;
+            else logFormat = LOG_TEXT;
+        }
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "info") == 0) logLevel = LOG_INFO;
+            else if (strcmp(argv[i], "warn") == 0) logLevel = LOG_WARN;
+            else if (strcmp(argv[i], "error") == 0) logLevel = LOG_ERROR;
+            else logLevel = LOG_DEBUG;
+        }
+        else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        }
+        else {
+            videofiles.push_back(argv[i]);
+        }
+    }
+
+    if ((!headless && (videofiles.size() > 1 || output != NULL)) || (headless && videofiles.empty())) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Bordas de entrada do modo --roi: as indicadas em --roi-edges (l, r, t, b; "-" = nenhuma) ou,
+    // sem essa opção, todas (as moedas que entram entre frames inteiros são logo encontradas)
+    if (options.roiTracking) {
+        if (roiEdges == NULL) {
+            options.roiEntryEdges = ROI_EDGE_LEFT | ROI_EDGE_RIGHT | ROI_EDGE_TOP | ROI_EDGE_BOTTOM;
+        }
+        else {
+            options.roiEntryEdges = 0;
+            for (const char* c = roiEdges; *c; c++) {
+                if (*c == 'l') options.roiEntryEdges |= ROI_EDGE_LEFT;
+                else if (*c == 'r') options.roiEntryEdges |= ROI_EDGE_RIGHT;
+                else if (*c == 't') options.roiEntryEdges |= ROI_EDGE_TOP;
+                else if (*c == 'b') options.roiEntryEdges |= ROI_EDGE_BOTTOM;
+            }
+        }
+    }
+
+    // Sem janela, as mensagens de cada moeda só com --verbose ou --log (por omissão o stdout leva só os resultados)
+    if (headless) options.verbose = verbose;
+
+    // Registo das mensagens de cada moeda: escrito numa thread própria, no stdout ou em --log
+    if (options.verbose && !eventLog.start(logfile, logFormat, logLevel)) {
+        std::cerr << "Erro ao criar o ficheiro de registos: " << logfile << std::endl;
+        return 1;
+    }
+
+    int result;
+    if (!headless) {
+        result = run_interactive(videofiles.empty() ? "video1.mp4" : videofiles[0], options);
+    }
+    else if (output != NULL) {
+        std::ofstream file(output);
+        if (!file) {
+            std::cerr << "Erro ao criar o ficheiro de resultados: " << output << std::endl;
+            return 1;
+        }
+        result = run_headless(videofiles, options, file);
+    }
+    else {
+        result = run_headless(videofiles, options, std::cout);
+    }
+
+    eventLog.stop();
+    if (eventLog.dropped() > 0) std::cerr << "Mensagens descartadas (registo atrasado): " << eventLog.dropped() << std::endl;
+
+    // Tempos por etapa (no stderr: o stdout fica só com os resultados)
+    if (profile) profile_dump(std::cerr);
+    return result;
 }
\ No newline at end of file
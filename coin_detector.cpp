@@ -11,150 +11,706 @@
 
 #include "coin_detector.h"
 #include "coin_utils.h"
+#include "coin_profile.h"
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+// Intervalos HSV das cores das moedas (H em graus, S e V em %)
+static const HVC COIN_COLOUR_RANGES[] = {
+    { 20, 40, 30, 100, 10, 50 },   // copper
+    { 43, 72, 19, 70, 7, 64 },     // gold
+    { 50, 150, 1, 25, 10, 55 },    // silver
+};
+static const int N_COIN_COLOUR_RANGES = sizeof(COIN_COLOUR_RANGES) / sizeof(COIN_COLOUR_RANGES[0]);
+
+CoinDetector::CoinDetector(const DetectorOptions& options, ThreadPool* pool) : options(options),
+    sharedPool(pool), TotalCoins(0), nextTrackId(0), lastFullFrame(-1), lastRefreshFrame(-1) {
+    reset();
+}
+
+// Funo para recomear a contagem (novo vdeo): esquece as moedas seguidas e pe as contagens a zero
+void CoinDetector::reset() {
+    trackedCoins.clear();
+    trackGrid.clear();
+    coinCount.fill(0);
+    TotalCoins = 0;
+    nextTrackId = 0;
+    lastFullFrame = -1;
+    lastRefreshFrame = -1;
+}
+
+// Pool das faixas: o partilhado ou um prprio (recriado s se o nmero de threads pedido mudar)
+ThreadPool& CoinDetector::threads() {
+    if (sharedPool != NULL) return *sharedPool;
+
+    int nthreads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    if (nthreads <= 0) nthreads = 1;
+    if (!ownPool || ownPool->size() != nthreads) {
+        ownPool.reset(new ThreadPool(nthreads));
+    }
+    return *ownPool;
+}
+
+FrameWorkspace::FrameWorkspace() : width(0), height(0), halo(0), frame_view(), mask(NULL),
+    closed(NULL), labelling(NULL), colourLut(NULL), coarse(NULL) {
+}
+
+FrameWorkspace::~FrameWorkspace() {
+    release();
+}
+
+// Funo para (re)alocar as imagens do workspace; no faz nada se a resoluo e as faixas no mudaram
+bool FrameWorkspace::prepare(int newWidth, int newHeight, int nbands, int newHalo) {
+    if (nbands > newHeight) nbands = newHeight;
+    if (nbands < 1) nbands = 1;
+
+    if (labelling != NULL && width == newWidth && height == newHeight &&
+        (int)bands.size() == nbands && halo == newHalo) return true;
+
+    release();
+
+    mask = vc_image_new(newWidth, newHeight, 1, 255);
+    closed = vc_image_new(newWidth, newHeight, 1, 255);
+    labelling = vc_labelling_new(newWidth, newHeight);
+    if (mask == NULL || closed == NULL || labelling == NULL) {
+        release();
+        return false;
+    }
+
+    bands.resize(nbands);
+    for (int b = 0; b < nbands; b++) {
+        FrameBand& band = bands[b];
+        band.y0 = (int)((long)newHeight * b / nbands);
+        band.y1 = (int)((long)newHeight * (b + 1) / nbands);
+        band.ys = std::max(band.y0 - newHalo, 0);
+        band.ye = std::min(band.y1 + newHalo, newHeight);
+
+        int rows = band.ye - band.ys;
+        band.opened = vc_image_new(newWidth, rows, 1, 255);
+        band.closed = vc_image_new(newWidth, rows, 1, 255);
+        band.temp = vc_image_new(newWidth, rows, 1, 255);
+        band.morph = vc_morph_new(newWidth, rows);
+        band.packedMask = vc_packed_new(newWidth, rows);
+        band.packedClosed = vc_packed_new(newWidth, rows);
+        band.packedTemp = vc_packed_new(newWidth, rows);
+        band.background = NULL;
+        if (band.opened == NULL || band.closed == NULL || band.temp == NULL || band.morph == NULL ||
+            band.packedMask == NULL || band.packedClosed == NULL || band.packedTemp == NULL) {
+            release();
+            return false;
+        }
+    }
+
+    width = newWidth;
+    height = newHeight;
+    halo = newHalo;
+    return true;
+}
+
+// Funo para libertar todas as imagens do workspace
+void FrameWorkspace::release() {
+    mask = vc_image_free(mask);
+    closed = vc_image_free(closed);
+    for (FrameBand& band : bands) {
+        vc_image_free(band.opened);
+        vc_image_free(band.closed);
+        vc_image_free(band.temp);
+        vc_morph_free(band.morph);
+        vc_packed_free(band.packedMask);
+        vc_packed_free(band.packedClosed);
+        vc_packed_free(band.packedTemp);
+        vc_background_free(band.background);
+    }
+    bands.clear();
+    for (FrameRoi& roi : rois) roi.release();
+    coarseRoi.release();
+    coarse = vc_image_free(coarse);
+    rois.clear();
+    roiRects.clear();
+    labelling = vc_labelling_free(labelling);
+    colourLut = vc_colour_lut_free(colourLut);
+    width = 0;
+    height = 0;
+    halo = 0;
+}
+
+FrameRoi::FrameRoi() : mask(NULL), opened(NULL), closed(NULL), temp(NULL), morph(NULL),
+    packedMask(NULL), packedClosed(NULL), packedTemp(NULL), labelling(NULL), cut(0) {
+}
+
+// Funo para (re)alocar as imagens da regio; no faz nada se o tamanho no mudou
+bool FrameRoi::prepare(int width, int height) {
+    if (labelling != NULL && labelling->width == width && labelling->height == height) return true;
+
+    release();
+
+    mask = vc_image_new(width, height, 1, 255);
+    opened = vc_image_new(width, height, 1, 255);
+    closed = vc_image_new(width, height, 1, 255);
+    temp = vc_image_new(width, height, 1, 255);
+    morph = vc_morph_new(width, height);
+    packedMask = vc_packed_new(width, height);
+    packedClosed = vc_packed_new(width, height);
+    packedTemp = vc_packed_new(width, height);
+    labelling = vc_labelling_new(width, height);
+    if (mask == NULL || opened == NULL || closed == NULL || temp == NULL || morph == NULL ||
+        packedMask == NULL || packedClosed == NULL || packedTemp == NULL || labelling == NULL) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void FrameRoi::release() {
+    mask = vc_image_free(mask);
+    opened = vc_image_free(opened);
+    closed = vc_image_free(closed);
+    temp = vc_image_free(temp);
+    morph = vc_morph_free(morph);
+    packedMask = vc_packed_free(packedMask);
+    packedClosed = vc_packed_free(packedClosed);
+    packedTemp = vc_packed_free(packedTemp);
+    labelling = vc_labelling_free(labelling);
+    blobs.clear();
+}
+
+// Vista IVC sobre as linhas [y0, y1) de uma imagem
+static IVC ivc_rows(IVC* image, int y0, int y1) {
+    IVC view;
+    vc_image_view(&view, image->data + (long)y0 * image->bytesperline, image->width, y1 - y0,
+        image->channels, image->bytesperline);
+    return view;
+}
 
-extern "C" {
-#include "vc.h"
+// Segmentao das trs cores (copper, gold, silver) de uma vista do frame
+static void segment_view(const DetectorOptions& options, FrameWorkspace& workspace, IVC* frame, IVC* mask) {
+    if (options.useColourLut) {
+        vc_bgr_lut_segmentation(frame, mask, NULL, workspace.colourLut);
+    }
+    else {
+        // Converso HSV exata
+        vc_bgr_hsv_segmentation_multi(frame, mask, NULL, COIN_COLOUR_RANGES, N_COIN_COLOUR_RANGES);
+    }
 }
 
-// Funo para processar um frame do vdeo e detectar moedas
-void detect_coins_in_frame(cv::Mat& frame, int currentFrame) {
+// Segmentao nas linhas de uma faixa. Com changeGating, s nos blocos que mudaram em relao ao
+// modelo de fundo da faixa (refresh = todos); a mscara dos outros blocos  a do frame anterior
+static void segment_band(const DetectorOptions& options, FrameWorkspace& workspace, FrameBand& band, bool refresh) {
+    IVC frame = ivc_rows(&workspace.frame_view, band.y0, band.y1);
+    IVC mask = ivc_rows(workspace.mask, band.y0, band.y1);
+
+    if (!options.changeGating) {
+        segment_view(options, workspace, &frame, &mask);
+        return;
+    }
+
+    if (band.background == NULL || band.background->tile != options.changeTile) {
+        vc_background_free(band.background);
+        band.background = vc_background_new(frame.width, frame.height, 3, options.changeTile);
+    }
+
+    // Sem modelo (falta de memria) ou sem blocos por reaproveitar: a faixa inteira
+    BVC* bg = band.background;
+    int changed = (bg != NULL) ? vc_background_update(&frame, bg, options.changeThreshold, 3) : -1;
+    if (refresh || changed < 0 || changed == bg->tilesx * bg->tilesy) {
+        segment_view(options, workspace, &frame, &mask);
+        return;
+    }
+
+    // Blocos seguidos de uma linha de blocos numa s chamada
+    for (int ty = 0; ty < bg->tilesy; ty++) {
+        const unsigned char* flags = &bg->changed[ty * bg->tilesx];
+        int y = ty * bg->tile, h = std::min(bg->tile, frame.height - y);
+
+        for (int tx = 0; tx < bg->tilesx; tx++) {
+            if (!flags[tx]) continue;
+
+            int first = tx;
+            while (tx + 1 < bg->tilesx && flags[tx + 1]) tx++;
+
+            int x = first * bg->tile, w = std::min((tx + 1) * bg->tile, frame.width) - x;
+            IVC frameTiles, maskTiles;
+            vc_image_view(&frameTiles, frame.data + (long)y * frame.bytesperline + x * 3, w, h, 3, frame.bytesperline);
+            vc_image_view(&maskTiles, mask.data + (long)y * mask.bytesperline + x, w, h, 1, mask.bytesperline);
+            segment_view(options, workspace, &frameTiles, &maskTiles);
+        }
+    }
+}
+
+// Abertura e fecho de uma faixa: processa as linhas [ys, ye) da mscara e guarda s [y0, y1),
+// que no dependem das linhas fora da margem
+static void morph_band(const DetectorOptions& options, FrameWorkspace& workspace, FrameBand& band) {
+    IVC mask = ivc_rows(workspace.mask, band.ys, band.ye);
+    IVC closed = ivc_rows(workspace.closed, band.y0, band.y1);
+    int inner = band.y0 - band.ys;
+
+    if (options.packedMorphology && options.morphShape == VC_MORPH_SQUARE) {
+        // Mesmo resultado, com 64 pixels por operao
+        vc_packed_from_binary(&mask, band.packedMask);
+        vc_packed_open(band.packedMask, band.packedClosed, band.packedTemp, options.morphKernel);
+        vc_packed_close(band.packedClosed, band.packedClosed, band.packedTemp, options.morphKernel);
+
+        PVC rows = *band.packedClosed;
+        rows.data += (long)inner * rows.wordsperline;
+        rows.height = band.y1 - band.y0;
+        vc_packed_to_binary(&rows, &closed);
+    }
+    else {
+        vc_binary_open_ws(&mask, band.opened, band.temp,
+            options.morphKernel, options.morphShape, band.morph);
+        vc_binary_close_ws(band.opened, band.closed, band.temp,
+            options.morphKernel, options.morphShape, band.morph);
+
+        for (int y = 0; y < band.y1 - band.y0; y++) {
+            memcpy(closed.data + (long)y * closed.bytesperline,
+                band.closed->data + (long)(y + inner) * band.closed->bytesperline, closed.width);
+        }
+    }
+}
+
+// Segmentao, abertura/fecho e etiquetagem de uma regio de source (o frame ou o frame reduzido); guarda em
+// roi.blobs, em coordenadas de source, os blobs que no tocam nas bordas da regio (os que tocam podem estar
+// cortados, exceto nas bordas da imagem). As bordas que cortam um blob com rea de pelo menos metade de
+// MIN_COIN_AREA ficam em roi.cut (a regio tem de crescer desse lado)
+static bool process_roi(const DetectorOptions& options, FrameWorkspace& workspace, IVC* source, const cv::Rect& rect, FrameRoi& roi) {
+    IVC frame;
+    int nblobs = 0;
+
+    roi.blobs.clear();
+    roi.cut = 0;
+    if (!roi.prepare(rect.width, rect.height)) return false;
+
+    vc_image_view(&frame, source->data + (long)rect.y * source->bytesperline + rect.x * 3,
+        rect.width, rect.height, 3, source->bytesperline);
+    segment_view(options, workspace, &frame, roi.mask);
+
+    if (options.packedMorphology && options.morphShape == VC_MORPH_SQUARE) {
+        vc_packed_from_binary(roi.mask, roi.packedMask);
+        vc_packed_open(roi.packedMask, roi.packedClosed, roi.packedTemp, options.morphKernel);
+        vc_packed_close(roi.packedClosed, roi.packedClosed, roi.packedTemp, options.morphKernel);
+        vc_packed_to_binary(roi.packedClosed, roi.closed);
+    }
+    else {
+        vc_binary_open_ws(roi.mask, roi.opened, roi.temp, options.morphKernel, options.morphShape, roi.morph);
+        vc_binary_close_ws(roi.opened, roi.closed, roi.temp, options.morphKernel, options.morphShape, roi.morph);
+    }
+
+    OVC* blobs = vc_binary_blob_labelling3(roi.closed, NULL, &frame, &nblobs, roi.labelling);
+    if (blobs == NULL) return nblobs == 0;
+
+    bool left = rect.x > 0, top = rect.y > 0;
+    bool right = rect.x + rect.width < source->width, bottom = rect.y + rect.height < source->height;
+
+    for (int i = 0; i < nblobs; i++) {
+        OVC blob = blobs[i];
+
+        // A etiquetagem ignora a linha/coluna da borda, por isso "tocar"  chegar  segunda
+        int cut = 0;
+        if (left && blob.x <= 1) cut |= ROI_EDGE_LEFT;
+        if (top && blob.y <= 1) cut |= ROI_EDGE_TOP;
+        if (right && blob.x + blob.width >= rect.width - 1) cut |= ROI_EDGE_RIGHT;
+        if (bottom && blob.y + blob.height >= rect.height - 1) cut |= ROI_EDGE_BOTTOM;
+        if (cut != 0) {
+            if (2 * blob.area >= MIN_COIN_AREA) roi.cut |= cut;
+            continue;
+        }
+
+        blob.x += rect.x;
+        blob.y += rect.y;
+        blob.xc += rect.x;
+        blob.yc += rect.y;
+        blob.cx += rect.x;
+        blob.cy += rect.y;
+        roi.blobs.push_back(blob);
+    }
+    return true;
+}
+
+// Arredonda o tamanho de uma regio (para as imagens da regio serem reutilizadas entre frames)
+// e desloca-a para dentro do frame, mantendo o centro sempre que possvel
+static cv::Rect fit_roi(const cv::Rect& r, int width, int height) {
+    int w = std::min((r.width + 31) / 32 * 32, width);
+    int h = std::min((r.height + 15) / 16 * 16, height);
+    int x = std::min(std::max(r.x - (w - r.width) / 2, 0), width - w);
+    int y = std::min(std::max(r.y - (h - r.height) / 2, 0), height - h);
+
+    return cv::Rect(x, y, w, h);
+}
+
+// Alarga a regio do lado das bordas cut (ROI_EDGE_*), em metade do seu tamanho (pelo menos 32 px)
+static cv::Rect grow_roi(const cv::Rect& r, int cut, int width, int height) {
+    int dx = std::max(r.width / 2, 32), dy = std::max(r.height / 2, 32);
+    int x0 = r.x, y0 = r.y, x1 = r.x + r.width, y1 = r.y + r.height;
+
+    if (cut & ROI_EDGE_LEFT) x0 -= dx;
+    if (cut & ROI_EDGE_RIGHT) x1 += dx;
+    if (cut & ROI_EDGE_TOP) y0 -= dy;
+    if (cut & ROI_EDGE_BOTTOM) y1 += dy;
+    return fit_roi(cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, width, height), width, height);
+}
+
+// Junta as regies que se sobrepem (cada pixel  processado uma s vez)
+static void merge_rois(std::vector<cv::Rect>& rects, int width, int height) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                if ((rects[i] & rects[j]).area() == 0) continue;
+                rects[i] = fit_roi(rects[i] | rects[j], width, height);
+                rects.erase(rects.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+// Regies do frame: posio prevista de cada moeda seguida com margem, e as bordas de entrada;
+// as regies que se sobrepem so juntadas
+void CoinDetector::plan_rois(int width, int height, int currentFrame) {
+    std::vector<cv::Rect>& rects = workspace.roiRects;
+    cv::Rect frameRect(0, 0, width, height);
+    int band = std::min(options.roiEntryBand, std::min(width, height));
+
+    rects.clear();
+
+    for (const CoinTrack& coin : trackedCoins) {
+        cv::Rect p = predictBBox(coin, currentFrame);
+        cv::Rect r(p.x - options.roiMargin, p.y - options.roiMargin,
+            p.width + 2 * options.roiMargin, p.height + 2 * options.roiMargin);
+        if ((r & frameRect).area() > 0) rects.push_back(fit_roi(r & frameRect, width, height));
+    }
+
+    if (band > 0) {
+        if (options.roiEntryEdges & ROI_EDGE_LEFT) rects.push_back(fit_roi(cv::Rect(0, 0, band, height), width, height));
+        if (options.roiEntryEdges & ROI_EDGE_RIGHT) rects.push_back(fit_roi(cv::Rect(width - band, 0, band, height), width, height));
+        if (options.roiEntryEdges & ROI_EDGE_TOP) rects.push_back(fit_roi(cv::Rect(0, 0, width, band), width, height));
+        if (options.roiEntryEdges & ROI_EDGE_BOTTOM) rects.push_back(fit_roi(cv::Rect(0, height - band, width, band), width, height));
+    }
+
+    merge_rois(rects, width, height);
+}
+
+// Regies do frame a partir do frame reduzido pyramidFactor vezes: os blobs encontrados nele (com a rea,
+//  escala do frame, de pelo menos metade de MIN_COIN_AREA) do as regies onde as moedas so medidas
+//  resoluo completa. A margem cobre o erro da caixa reduzida e o alcance da abertura/fecho
+bool CoinDetector::plan_coarse_rois(int width, int height) {
+    std::vector<cv::Rect>& rects = workspace.roiRects;
+    int factor = options.pyramidFactor;
+    int margin = 2 * factor + 4 * (options.morphKernel / 2) + 4;
+
+    rects.clear();
+
+    if (workspace.coarse == NULL || workspace.coarse->width != width / factor || workspace.coarse->height != height / factor) {
+        vc_image_free(workspace.coarse);
+        workspace.coarse = vc_image_new(width / factor, height / factor, 3, 255);
+        if (workspace.coarse == NULL) return false;
+    }
+
+    IVC* coarse = workspace.coarse;
+    if (!vc_image_subsample(&workspace.frame_view, coarse, factor)) return false;
+    if (!process_roi(options, workspace, coarse, cv::Rect(0, 0, coarse->width, coarse->height), workspace.coarseRoi)) return false;
+
+    for (const OVC& blob : workspace.coarseRoi.blobs) {
+        if (2 * blob.area * factor * factor < MIN_COIN_AREA) continue;
+
+        cv::Rect r(blob.x * factor - margin, blob.y * factor - margin,
+            (blob.width + 1) * factor + 2 * margin, (blob.height + 1) * factor + 2 * margin);
+        rects.push_back(fit_roi(r & cv::Rect(0, 0, width, height), width, height));
+    }
+
+    merge_rois(rects, width, height);
+    return true;
+}
+
+// Processa as regies do frame em paralelo (uma tarefa por regio) e junta os blobs, pela ordem das regies.
+// Uma regio que corta uma possvel moeda  alargada desse lado (e juntada s que passar a sobrepor) e todas
+// so processadas de novo, at nenhuma cortar (as bordas do frame no cortam: termina no frame inteiro)
+OVC* CoinDetector::process_rois(ThreadPool& pool, int* nlabels) {
+    std::vector<cv::Rect>& rects = workspace.roiRects;
+    std::atomic<bool> failed(false);
+    int nrois;
+
+    for (;;) {
+        nrois = (int)rects.size();
+        if ((int)workspace.rois.size() < nrois) workspace.rois.resize(nrois);
+
+        pool.parallel_for(nrois, [&](int r) {
+            if (!process_roi(options, workspace, &workspace.frame_view, rects[r], workspace.rois[r])) failed.store(true);
+        });
+        if (failed.load()) break;
+
+        bool grown = false;
+        for (int r = 0; r < nrois; r++) {
+            if (workspace.rois[r].cut == 0) continue;
+            rects[r] = grow_roi(rects[r], workspace.rois[r].cut, workspace.frame_view.width, workspace.frame_view.height);
+            grown = true;
+        }
+        if (!grown) break;
+        merge_rois(rects, workspace.frame_view.width, workspace.frame_view.height);
+    }
+
+    workspace.roiBlobs.clear();
+    for (int r = 0; r < nrois; r++) {
+        workspace.roiBlobs.insert(workspace.roiBlobs.end(), workspace.rois[r].blobs.begin(), workspace.rois[r].blobs.end());
+    }
+
+    *nlabels = (int)workspace.roiBlobs.size();
+    if (failed.load()) {
+        std::cerr << "Erro ao processar as regies do frame!" << std::endl;
+        *nlabels = 0;
+        return NULL;
+    }
+    return workspace.roiBlobs.empty() ? NULL : workspace.roiBlobs.data();
+}
+
+// Modo validatePyramid: processa tambm o frame inteiro  resoluo completa (sem changeGating, para no
+// mexer no modelo de fundo) e reporta as possveis moedas (rea >= MIN_COIN_AREA) que s um dos caminhos
+// encontrou, ou com caixa, rea ou permetro diferentes
+void CoinDetector::validate_pyramid(ThreadPool& pool, int currentFrame, const OVC* blobs, int nblobs) {
+    DetectorOptions exact = options;
+    int nbands = (int)workspace.bands.size();
+    int nfull = 0;
+
+    exact.changeGating = false;
+    pool.parallel_for(nbands, [&](int b) { segment_band(exact, workspace, workspace.bands[b], true); });
+    pool.parallel_for(nbands, [&](int b) { morph_band(exact, workspace, workspace.bands[b]); });
+    OVC* full = vc_binary_blob_labelling_strips(workspace.closed, NULL, &workspace.frame_view, &nfull,
+        workspace.labelling, nbands, ThreadPool::vc_parallel, &pool);
+    if (full == NULL) nfull = 0;
+
+    auto same = [](const OVC& a, const OVC& b) {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height &&
+            a.area == b.area && a.perimeter == b.perimeter;
+    };
+    auto found = [&](const OVC& blob, const OVC* list, int n) {
+        for (int i = 0; i < n; i++) if (same(blob, list[i])) return true;
+        return false;
+    };
+
+    int onlyFull = 0, onlyRois = 0;
+    for (int i = 0; i < nfull; i++) {
+        if (full[i].area >= MIN_COIN_AREA && !found(full[i], blobs, nblobs)) onlyFull++;
+    }
+    for (int i = 0; i < nblobs; i++) {
+        if (blobs[i].area >= MIN_COIN_AREA && !found(blobs[i], full, nfull)) onlyRois++;
+    }
+
+    if (onlyFull != 0 || onlyRois != 0) {
+        std::cerr << "Pirmide: frame " << currentFrame << ": " << onlyFull << " moedas s no frame inteiro, "
+            << onlyRois << " s nas regies" << std::endl;
+    }
+}
+
+// Evento de uma moeda seguida para o registo (os campos de cada tipo de evento so preenchidos por quem regista)
+static LogEvent coin_event(LogEventKind kind, int stream, int frame, const CoinTrack& coin) {
+    LogEvent event = {};
+
+    event.kind = (uint8_t)kind;
+    event.stream = (int16_t)stream;
+    event.frame = frame;
+    event.track = coin.id;
+    event.type = coin.type;
+    event.area = coin.finalArea;
+    event.perimeter = coin.finalPerimeter;
+    event.circularity = coin.finalCircularity;
+    return event;
+}
+
+// Funo para processar um frame do vdeo e detectar moedas, desenhando logo os resultados sobre o frame
+void CoinDetector::process_frame(cv::Mat& frame, int currentFrame) {
+    workspace.overlay.clear();
+    process_frame(frame, currentFrame, workspace.overlay);
+
+    PROFILE_SCOPE(PROFILE_RENDER);
+    renderer.render(workspace.overlay, frame);
+}
+
+// Funo para processar um frame do vdeo e detectar moedas; os desenhos ficam registados em overlay
+void CoinDetector::process_frame(cv::Mat& frame, int currentFrame, Overlay& overlay) {
+    PROFILE_SCOPE(PROFILE_FRAME);
 
     int width = frame.cols;
     int height = frame.rows;
     int nlabels = 0;
-    static int TotalCoins = 0;
 
     OVC* blobs;
+    const bool draw = options.draw;
+    const bool verbose = options.verbose;
 
-    // Criar imagens IVC para processamento
-    IVC* image[10];
-
-    // Converter frame cv::Mat para IVC (BGR para RGB)
-    cv::Mat frame_rgb;
-    cv::cvtColor(frame, frame_rgb, cv::COLOR_BGR2RGB);
+    ThreadPool& pool = threads();
 
-    image[0] = vc_image_new(width, height, 3, 255);
-    if (image[0] == NULL) {
-        std::cerr << "Erro ao criar imagem principal!" << std::endl;
+    // Imagens IVC para processamento (alocadas uma vez pelo workspace), uma faixa por thread
+    // A abertura e o fecho (4 operaes de meia-largura kernel / 2) precisam de 4 * (kernel / 2) linhas de margem
+    if (!workspace.prepare(width, height, pool.size(), 4 * (options.morphKernel / 2))) {
+        std::cerr << "Erro ao criar imagens de processamento!" << std::endl;
         return;
     }
+    int nbands = (int)workspace.bands.size();
 
-    // Copiar dados do frame para a imagem IVC
-    memcpy(image[0]->data, frame_rgb.data, width * height * 3);
+    // Vista IVC sobre o frame (BGR), sem converso nem cpia
+    if (!mat_to_ivc_view(frame, &workspace.frame_view)) {
+        std::cerr << "Erro ao criar vista sobre o frame!" << std::endl;
+        return;
+    }
 
-    // Criar imagens auxiliares
-    for (int i = 1; i < 10; i++) {
-        image[i] = vc_image_new(width, height, (i == 1) ? 3 : 1, 255);
-        if (image[i] == NULL) {
-            std::cerr << "Erro ao criar imagens auxiliares!" << std::endl;
-            for (int j = 0; j < i; j++) {
-                vc_image_free(image[j]);
+    if (options.useColourLut) {
+        // Tabela criada uma vez a partir dos intervalos HSV (ou quando muda a quantizao)
+        if (workspace.colourLut == NULL || workspace.colourLut->bits != options.colourLutBits) {
+            vc_colour_lut_free(workspace.colourLut);
+            workspace.colourLut = vc_colour_lut_new(COIN_COLOUR_RANGES, N_COIN_COLOUR_RANGES, options.colourLutBits);
+            if (workspace.colourLut == NULL) {
+                std::cerr << "Erro ao criar a tabela de cores!" << std::endl;
+                return;
             }
-            return;
         }
     }
 
-    // Processamento de imagem
-    vc_rgb_to_hsv(image[0], image[1]);
+    // Modo roiTracking: entre frames inteiros, s as regies  volta das moedas seguidas e das bordas de entrada
+    bool fullFrame = !options.roiTracking || lastFullFrame < 0 || currentFrame < lastFullFrame ||
+        currentFrame - lastFullFrame >= options.roiFullFrameInterval;
+
+    if (fullFrame && options.pyramidFactor > 1) {
+        // Modo pyramidFactor: procurar no frame reduzido e medir s  volta do que for encontrado
+        PROFILE_SCOPE(PROFILE_ROIS);
+        if (!plan_coarse_rois(width, height)) {
+            std::cerr << "Erro ao processar o frame reduzido!" << std::endl;
+            return;
+        }
+        blobs = process_rois(pool, &nlabels);
+        if (options.validatePyramid) validate_pyramid(pool, currentFrame, blobs, nlabels);
+        lastFullFrame = currentFrame;
+    }
+    else if (fullFrame) {
+        // Modo changeGating: todos os blocos a cada changeRefreshInterval frames
+        bool refresh = lastRefreshFrame < 0 || currentFrame < lastRefreshFrame ||
+            currentFrame - lastRefreshFrame >= options.changeRefreshInterval;
+        if (refresh) lastRefreshFrame = currentFrame;
+
+        // Segmentao das trs cores numa s passagem, por faixas
+        {
+            PROFILE_SCOPE(PROFILE_SEGMENT);
+            pool.parallel_for(nbands, [&](int b) { segment_band(options, workspace, workspace.bands[b], refresh); });
+        }
 
-    // Segmentao HSV
-    vc_hsv_segmentation(image[1], image[2], 20, 40, 30, 100, 10, 50); //  copper
-    vc_hsv_segmentation(image[1], image[6], 43, 72, 19, 70, 7, 64); // gold
-    vc_hsv_segmentation(image[1], image[8], 50, 150, 1, 25, 10, 55); // silver
+        if (options.useColourLut && options.validateColourLut) {
+            long int mismatches = vc_bgr_colour_lut_validate(&workspace.frame_view, workspace.colourLut,
+                COIN_COLOUR_RANGES, N_COIN_COLOUR_RANGES);
+            if (mismatches != 0) {
+                std::cerr << "Tabela de cores: " << mismatches << " pixels divergentes no frame "
+                    << currentFrame << std::endl;
+            }
+        }
 
-    // Juno das Segmentaes HSV para s uma imagem
-    vc_join_segmentations(image[2], image[6], image[7]);
-    vc_join_segmentations(image[7], image[8], image[9]);
+        // Operaes morfolgicas, por faixas (cada uma l as linhas de margem das vizinhas)
+        {
+            PROFILE_SCOPE(PROFILE_MORPH);
+            pool.parallel_for(nbands, [&](int b) { morph_band(options, workspace, workspace.bands[b]); });
+        }
 
-    // Operaes morfolgicas
-    vc_binary_open(image[9], image[3], 3);
-    vc_binary_close(image[3], image[4], 3);
+        // Etiquetagem dos blobs(moedas) por faixas; o mapa de etiquetas fica no workspace (vc_labelling_labels)
+        {
+            PROFILE_SCOPE(PROFILE_LABEL);
+            blobs = vc_binary_blob_labelling_strips(workspace.closed, NULL, &workspace.frame_view, &nlabels,
+                workspace.labelling, nbands, ThreadPool::vc_parallel, &pool);
+        }
 
-    // Etiquetagem dos blobs(moedas)
-    blobs = vc_binary_blob_labelling2(image[4], image[5], &nlabels);
+        lastFullFrame = currentFrame;
+    }
+    else {
+        PROFILE_SCOPE(PROFILE_ROIS);
+        plan_rois(width, height, currentFrame);
+        blobs = process_rois(pool, &nlabels);
+    }
 
     if (blobs != NULL && nlabels > 0) {
+        PROFILE_SCOPE(PROFILE_TRACK);
+
         // PRIMEIRO: Marcar todas as moedas existentes como no vistas neste frame
         for (auto& coin : trackedCoins) {
             coin.matched_this_frame = false;
         }
 
+        trackGrid.resize(frame.cols, frame.rows, trackedCoins);
+
+        // Modo de atribuio tima: os blobs so todos correspondidos antes de se criarem moedas novas
+        if (options.assignmentTracker) {
+            workspace.candidates.clear();
+            for (int i = 0; i < nlabels; i++) {
+                if (blobs[i].area < MIN_COIN_AREA) continue;
+                if (calculate_circularity(blobs[i].area, blobs[i].perimeter) < MIN_CIRCULARITY) continue;
+                workspace.candidates.push_back(cv::Rect(blobs[i].x, blobs[i].y, blobs[i].width, blobs[i].height));
+            }
+            assignCoins(trackedCoins, trackGrid, workspace.candidates, workspace.assigned);
+        }
+        int candidate = 0;
+
         // SEGUNDO: Para cada blob detectado, encontrar correspondncia
         for (int i = 0; i < nlabels; i++) {
 
-			if (blobs[i].area < 7000) continue; // Ignora blobs pequenos
+			if (blobs[i].area < MIN_COIN_AREA) continue; // Ignora blobs pequenos
             float circularity = calculate_circularity(blobs[i].area, blobs[i].perimeter);
             if (circularity < MIN_CIRCULARITY) continue; // Ignora blobs com formas poucas circulares
 
             cv::Rect rect(blobs[i].x, blobs[i].y, blobs[i].width, blobs[i].height);
-            int matchIndex = findMatchingCoin(rect, currentFrame);
+            int matchIndex = options.assignmentTracker ? workspace.assigned[candidate++] :
+                findMatchingCoin(trackedCoins, trackGrid, rect, currentFrame);
 
             cv::Point center(rect.x + rect.width / 2, rect.y + rect.height / 2);
 
-            cv::Vec3b white(255, 255, 0);  
-            drawCenter(frame, center, 2, white);  
+            if (draw) {
+                cv::Vec3b white(255, 255, 0);
+                overlay.fill(cv::Rect(center.x - 2, center.y - 2, 5, 5), white);
+            }
 
             if (matchIndex >= 0) {
 
-                cv::Vec3b pixel = frame_rgb.at<cv::Vec3b>(center);
-                cv::Mat pixelRGB(1, 1, CV_8UC3, pixel);
-                cv::Mat pixelHSV;
-                cv::cvtColor(pixelRGB, pixelHSV, cv::COLOR_RGB2HSV);
-                cv::Vec3b hsv = pixelHSV.at<cv::Vec3b>(0, 0);
-
-                // hsv[0] = Hue, hsv[1] = Saturation, hsv[2] = Value
-                int hue = hsv[0];
-                int sat = hsv[1];
-                int val = hsv[2];
-
-                // Lgica para distinguir moeda com base na cor do centro
-                std::string centerColor;
-                if (hue >= 25 && hue <= 30 && sat >= 20 && sat <= 140 && val >= 65 && val <= 150) {
-                    centerColor = "gold";
-                }
-                else if (hue >= 15 && hue <= 60 && sat >= 1 && sat <= 60 && val >= 10 && val <= 120) {
-                    centerColor = "silver";
-                }
-                else if (hue >= 10 && hue <= 60 && sat >= 80 && sat <= 215 && val >= 40 && val <= 120) {
-                    centerColor = "cooper";
+                // Cor mdia do disco interior e do anel exterior (calculadas na etiquetagem, antes de desenhar)
+                int hue, sat, val, ringHue, ringSat, ringVal;
+                bgr_to_hsv(blobs[i].innercolour, hue, sat, val);
+                bgr_to_hsv(blobs[i].outercolour, ringHue, ringSat, ringVal);
+
+                // Lgica para distinguir moeda com base na cor do centro e do anel
+                CoinColour centerColor = classify_colour(hue, sat, val);
+                CoinColour ringColor = classify_colour(ringHue, ringSat, ringVal);
+
+                if (verbose && eventLog.enabled(LOG_DEBUG)) {
+                    LogEvent event = coin_event(EVENT_COLOUR, options.stream, currentFrame, trackedCoins[matchIndex]);
+                    event.colour = (uint8_t)centerColor;
+                    event.ringColour = (uint8_t)ringColor;
+                    event.hsv[0] = (uint8_t)hue; event.hsv[1] = (uint8_t)sat; event.hsv[2] = (uint8_t)val;
+                    event.ringHsv[0] = (uint8_t)ringHue; event.ringHsv[1] = (uint8_t)ringSat; event.ringHsv[2] = (uint8_t)ringVal;
+                    eventLog.push(LOG_DEBUG, event);
                 }
-                else {
-                    centerColor = "indefinido";
-                }
-
-                std::cout << "Cor do centro: " << centerColor << " (H:" << hue << " S:" << sat << " V:" << val << ")" << std::endl;
 
                 // Marcar como correspondida
                 trackedCoins[matchIndex].matched_this_frame = true;
+                updateVelocity(trackedCoins[matchIndex], rect, currentFrame);
+                trackGrid.move(matchIndex, trackedCoins[matchIndex].bbox, rect);
                 trackedCoins[matchIndex].bbox = rect;
                 trackedCoins[matchIndex].lastSeenFrame = currentFrame;
 
                 // Se a moeda ja esta confirmada, mostrar area e permetro final
                 if (trackedCoins[matchIndex].typeConfirmed) {
+                    if (!draw) continue;
+
                     // VERDE - moeda confirmada
                     cv::Vec3b Green(0, 255, 0);
-                    drawRectangleManual(frame, rect, Green);
-
+                    overlay.box(rect, Green, 3);
 
                     // Mostrar TIPO, AREA, PERIMETRO e CIRCULARIDADE final da mnoeda
-                    char circularity_str[10];
-                    cv::putText(frame, trackedCoins[matchIndex].type,
-                        cv::Point(rect.x + 25, rect.y - 40),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
-
-                    sprintf(circularity_str, "%.2f", trackedCoins[matchIndex].finalCircularity);
-                    std::string infoText =
-                        "(A:" + std::to_string(trackedCoins[matchIndex].finalArea) +
-                        " P:" + std::to_string(trackedCoins[matchIndex].finalPerimeter) +
-                        " C:" + circularity_str + ")";
+                    overlay.text(cv::Point(rect.x + 25, rect.y - 40), 0.7, cv::Scalar(0, 255, 0), 2, true,
+                        "%s", coin_name(trackedCoins[matchIndex].type));
 
-                    cv::putText(frame, infoText,
-                        cv::Point(rect.x - 20, rect.y - 20),  // ligeiramente abaixo do texto anterior
-                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
+                    overlay.text(cv::Point(rect.x - 20, rect.y - 20),  // ligeiramente abaixo do texto anterior
+                        0.6, cv::Scalar(0, 255, 0), 2, true, "(A:%d P:%d C:%.2f)", trackedCoins[matchIndex].finalArea,
+                        trackedCoins[matchIndex].finalPerimeter, trackedCoins[matchIndex].finalCircularity);
 
                     continue; // PULAR para proximo blob
                 }
@@ -164,39 +720,20 @@ void detect_coins_in_frame(cv::Mat& frame, int currentFrame) {
                 int currentPerimeter = blobs[i].perimeter;
 
                 // Adicionar rea e permetro ao histrico para calcular estabilidade
-                trackedCoins[matchIndex].areaHistory.push_back(currentArea);
-                trackedCoins[matchIndex].perimeterHistory.push_back(currentPerimeter);
-
-                // Manter apenas as ltimas STABILITY_THRESHOLD reas e permetros
-                if (trackedCoins[matchIndex].areaHistory.size() > STABILITY_THRESHOLD) {
-                    trackedCoins[matchIndex].areaHistory.erase(
-                        trackedCoins[matchIndex].areaHistory.begin());
-                    trackedCoins[matchIndex].perimeterHistory.erase(
-                        trackedCoins[matchIndex].perimeterHistory.begin());
-                }
+                // (o histrico guarda s as ltimas STABILITY_THRESHOLD reas e permetros)
+                trackedCoins[matchIndex].areaHistory.push(currentArea);
+                trackedCoins[matchIndex].perimeterHistory.push(currentPerimeter);
 
                 // Verificar estabilidade se temos reas suficientes
-                if (trackedCoins[matchIndex].areaHistory.size() >= STABILITY_THRESHOLD) {
-                    bool isStable = true;
-                    int totalArea = 0;
-                    int totalPerimeter = 0;
-
-                    // Calcular rea e permetro mdios
-                    for (size_t j = 0; j < trackedCoins[matchIndex].areaHistory.size(); j++) {
-                        totalArea += trackedCoins[matchIndex].areaHistory[j];
-                        totalPerimeter += trackedCoins[matchIndex].perimeterHistory[j];
-                    }
-                    int avgArea = totalArea / trackedCoins[matchIndex].areaHistory.size();
-                    int avgPerimeter = totalPerimeter / trackedCoins[matchIndex].perimeterHistory.size();
-
-                    // Verificar se todas as reas esto dentro da variao permitida
-                    for (int area : trackedCoins[matchIndex].areaHistory) {
-                        float variation = abs(area - avgArea) / (float)avgArea;
-                        if (variation > MAX_AREA_VARIATION) {
-                            isStable = false;
-                            break;
-                        }
-                    }
+                if (trackedCoins[matchIndex].areaHistory.full()) {
+                    // rea e permetro mdios
+                    int avgArea = trackedCoins[matchIndex].areaHistory.mean();
+                    int avgPerimeter = trackedCoins[matchIndex].perimeterHistory.mean();
+
+                    // Todas as reas esto dentro da variao permitida se a menor e a maior estiverem
+                    float variationMin = abs(trackedCoins[matchIndex].areaHistory.min() - avgArea) / (float)avgArea;
+                    float variationMax = abs(trackedCoins[matchIndex].areaHistory.max() - avgArea) / (float)avgArea;
+                    bool isStable = variationMin <= MAX_AREA_VARIATION && variationMax <= MAX_AREA_VARIATION;
 
                     if (isStable) {
                         // CONFIRMAR o tipo com base na rea mdia
@@ -204,63 +741,47 @@ void detect_coins_in_frame(cv::Mat& frame, int currentFrame) {
                         trackedCoins[matchIndex].finalArea = avgArea;
                         trackedCoins[matchIndex].finalPerimeter = avgPerimeter;
                         trackedCoins[matchIndex].finalCircularity = calculate_circularity(avgArea, avgPerimeter);
-                        trackedCoins[matchIndex].type = std::string(classify_coin(avgArea, trackedCoins[matchIndex].finalCircularity, centerColor));
-
-                        std::cout << "=== MOEDA CONFIRMADA ===" << std::endl;
-                        std::cout << "Frame: " << currentFrame << std::endl;
-                        std::cout << "Tipo: " << trackedCoins[matchIndex].type << std::endl;
-                        std::cout << "rea final: " << avgArea << std::endl;
-                        std::cout << "Permetro final: " << avgPerimeter << std::endl;
-                        std::cout << "Circularidade final: " << trackedCoins[matchIndex].finalCircularity << std::endl;
-                        std::cout << "Histrico de reas: ";
-                        for (int area : trackedCoins[matchIndex].areaHistory) {
-                            std::cout << area << " ";
+                        trackedCoins[matchIndex].type = classify_coin(avgArea, trackedCoins[matchIndex].finalCircularity, centerColor, ringColor);
+
+                        if (verbose && eventLog.enabled(LOG_INFO)) {
+                            LogEvent event = coin_event(EVENT_CONFIRMED, options.stream, currentFrame, trackedCoins[matchIndex]);
+                            for (int j = 0; j < STABILITY_THRESHOLD; j++) {
+                                event.areaHistory[j] = trackedCoins[matchIndex].areaHistory[j];
+                                event.perimeterHistory[j] = trackedCoins[matchIndex].perimeterHistory[j];
+                            }
+                            eventLog.push(LOG_INFO, event);
                         }
-                        std::cout << std::endl;
-                        std::cout << "Histrico de permetros: ";
-                        for (int perimeter : trackedCoins[matchIndex].perimeterHistory) {
-                            std::cout << perimeter << " ";
-                        }
-                        std::cout << std::endl;
-                        std::cout << "========================" << std::endl;
                     }
                     else {
                         // Resetar o histrico se no estvel
                         trackedCoins[matchIndex].areaHistory.clear();
                         trackedCoins[matchIndex].perimeterHistory.clear();
-                        trackedCoins[matchIndex].areaHistory.push_back(currentArea);
-                        trackedCoins[matchIndex].perimeterHistory.push_back(currentPerimeter);
+                        trackedCoins[matchIndex].areaHistory.push(currentArea);
+                        trackedCoins[matchIndex].perimeterHistory.push(currentPerimeter);
                     }
                 }
 
+                if (!draw) continue;
+
                 // AZUL - moeda ainda em anlise
                 cv::Vec3b Blue(255, 0, 0);
-                drawRectangleManual(frame, rect, Blue);
+                overlay.box(rect, Blue, 3);
 
                 float current_circularity = calculate_circularity(currentArea, currentPerimeter);
-                char circularity_str[10];
-                sprintf(circularity_str, "%.2f", current_circularity);
-                cv::putText(frame, classify_coin(currentArea, current_circularity, centerColor),
-                    cv::Point(rect.x + 25, rect.y - 40),
-                    cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+                overlay.text(cv::Point(rect.x + 25, rect.y - 40), 0.7, cv::Scalar(255, 255, 255), 1, true,
+                    "%s", coin_name(classify_coin(currentArea, current_circularity, centerColor, ringColor)));
 
                 // Texto das informaes (embaixo do texto do tipo da moeda)
-                std::string infoText =
-                    "(A:" + std::to_string(currentArea) +
-                    " P:" + std::to_string(currentPerimeter) +
-                    " C:" + circularity_str +
-                    " " + std::to_string(trackedCoins[matchIndex].areaHistory.size()) +
-                    "/" + std::to_string(STABILITY_THRESHOLD) + ")";
-
-                cv::putText(frame, infoText,
-                    cv::Point(rect.x - 45, rect.y - 20),  // Aqui: 15 pixels abaixo do topo do retngulo
-                    cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+                overlay.text(cv::Point(rect.x - 45, rect.y - 20),  // Aqui: 15 pixels abaixo do topo do retngulo
+                    0.6, cv::Scalar(255, 255, 255), 1, false, "(A:%d P:%d C:%.2f %d/%d)", currentArea, currentPerimeter,
+                    current_circularity, trackedCoins[matchIndex].areaHistory.size(), STABILITY_THRESHOLD);
             }
             else {
                 // Nova moeda detetada
                 CoinTrack newCoin;
+                newCoin.id = nextTrackId++;
                 newCoin.bbox = rect;
-                newCoin.type = "A Carregar...";
+                newCoin.type = COIN_UNKNOWN;
                 newCoin.firstSeenFrame = currentFrame;
                 newCoin.lastSeenFrame = currentFrame;
                 newCoin.counted = false;
@@ -268,23 +789,21 @@ void detect_coins_in_frame(cv::Mat& frame, int currentFrame) {
                 newCoin.finalArea = 0;
                 newCoin.finalPerimeter = 0;
                 newCoin.matched_this_frame = true;
-                newCoin.areaHistory.push_back(blobs[i].area);
-                newCoin.perimeterHistory.push_back(blobs[i].perimeter);
+                newCoin.areaHistory.push(blobs[i].area);
+                newCoin.perimeterHistory.push(blobs[i].perimeter);
 
                 trackedCoins.push_back(newCoin);
+                trackGrid.insert((int)trackedCoins.size() - 1, rect);
+
+                if (!draw) continue;
 
                 // VERMELHO - nova moeda 
                 cv::Vec3b Red(0, 0, 255);
-                drawRectangleManual(frame, rect, Red);
+                overlay.box(rect, Red, 3);
 
                 float new_circularity = calculate_circularity(blobs[i].area, blobs[i].perimeter);
-                char circularity_str[10];
-                sprintf(circularity_str, "%.2f", new_circularity);
-                std::string text = "NOVA (A:" + std::to_string(blobs[i].area) +
-                    " P:" + std::to_string(blobs[i].perimeter) +
-                    " C:" + circularity_str + ")";
-                cv::putText(frame, text, cv::Point(rect.x + 5, rect.y - 10),
-                    cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 255), 1);
+                overlay.text(cv::Point(rect.x + 5, rect.y - 10), 0.5, cv::Scalar(0, 0, 255), 1, false,
+                    "NOVA (A:%d P:%d C:%.2f)", blobs[i].area, blobs[i].perimeter, new_circularity);
             }
         }
 
@@ -294,46 +813,44 @@ void detect_coins_in_frame(cv::Mat& frame, int currentFrame) {
                 coin.typeConfirmed &&
                 currentFrame - coin.firstSeenFrame >= FRAME_THRESHOLD) {
 
+                assert(coin.type >= 0 && coin.type < (int)coinCount.size());
                 coinCount[coin.type]++;
                 coin.counted = true;
                 TotalCoins++;
 
-                std::cout << ">>> MOEDA CONTADA: " << coin.type
-                    << " (Total: " << coinCount[coin.type]
-                    << ", rea: " << coin.finalArea
-                    << ", Permetro: " << coin.finalPerimeter
-                    << ", Circularidade: " << coin.finalCircularity << ")" << std::endl;
+                if (verbose && eventLog.enabled(LOG_INFO)) {
+                    LogEvent event = coin_event(EVENT_COUNTED, options.stream, currentFrame, coin);
+                    event.count = coinCount[coin.type];
+                    eventLog.push(LOG_INFO, event);
+                }
             }
         }
-
-        free(blobs);
     }
 
     // Mostrar contagem de moedas
-    int y_pos = 150;
-    for (const auto& pair : coinCount) {
-        if (pair.second > 0) {
-            std::string countText = pair.first + ": " + std::to_string(pair.second);
-            cv::putText(frame, countText, cv::Point(20, y_pos), cv::FONT_HERSHEY_SIMPLEX, 0.8,
-                cv::Scalar(255, 255, 255), 2);
-            y_pos += 25;
+    if (draw) {
+        int y_pos = 150;
+        for (int type = 0; type < (int)coinCount.size(); type++) {
+            if (coinCount[type] > 0) {
+                overlay.text(cv::Point(20, y_pos), 0.8, cv::Scalar(255, 255, 255), 2, true,
+                    "%s: %d", coin_name((CoinType)type), coinCount[type]);
+                y_pos += 25;
+            }
         }
-    }
 
-    std::string totalText = "TOTAL: " + std::to_string(TotalCoins);
-    cv::putText(frame, totalText, cv::Point(20, y_pos + 10), cv::FONT_HERSHEY_SIMPLEX, 0.9,
-        cv::Scalar(0, 255, 255), 2); // Amarelo
+        overlay.text(cv::Point(20, y_pos + 10), 0.9, cv::Scalar(0, 255, 255), 2, true, // Amarelo
+            "TOTAL: %d", TotalCoins);
+    }
 
     // Remover moedas antigas no vistas
     const int FORGET_THRESHOLD = 70;
+    size_t ntracked = trackedCoins.size();
     trackedCoins.erase(
         std::remove_if(trackedCoins.begin(), trackedCoins.end(),
             [currentFrame, FORGET_THRESHOLD](const CoinTrack& coin) {
                 return currentFrame - coin.lastSeenFrame > FORGET_THRESHOLD;
             }),trackedCoins.end());
 
-    // Liberar memoria
-    for (int i = 0; i < 10; i++) {
-        vc_image_free(image[i]);
-    }
+    // Os ndices das moedas que ficaram mudaram
+    if (trackedCoins.size() != ntracked) trackGrid.rebuild(trackedCoins);
 }
\ No newline at end of file
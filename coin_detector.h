@@ -11,8 +11,176 @@
 #define COIN_DETECTOR_H
 
 #include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
 
-// Funo principal para deteco de moedas
-void detect_coins_in_frame(cv::Mat& frame, int currentFrame);
+#include "coin_log.h"
+#include "coin_overlay.h"
+#include "coin_threads.h"
+#include "coin_utils.h"
+
+extern "C" {
+#include "vc.h"
+}
+
+// Bordas do frame por onde podem entrar moedas (DetectorOptions.roiEntryEdges)
+#define ROI_EDGE_LEFT     1
+#define ROI_EDGE_RIGHT    2
+#define ROI_EDGE_TOP      4
+#define ROI_EDGE_BOTTOM   8
+
+// Opes do detector
+struct DetectorOptions {
+    bool useColourLut;        // Segmentar a cor por tabela (RGB quantizado) em vez do clculo HSV
+    int colourLutBits;        // Bits por canal da tabela (5 = 32K, 6 = 256K entradas)
+    bool validateColourLut;   // Comparar a tabela com o clculo exato e reportar divergncias
+    int morphKernel;          // Tamanho do elemento estruturante da abertura/fecho
+    int morphShape;           // VC_MORPH_SQUARE ou VC_MORPH_DISK
+    bool packedMorphology;    // Abertura/fecho sobre mscaras de 1 bit por pixel (s elemento quadrado)
+    int threads;              // Threads por frame (0 = nmero de ncleos, 1 = sem threads auxiliares)
+    bool draw;                // Desenhar caixas, textos e contagem sobre o frame
+    bool verbose;             // Registar os eventos de cada moeda (cor, confirmao, contagem) em eventLog
+    int stream;               // Identificador do vdeo nos registos
+    bool assignmentTracker;   // Corresponder os blobs s moedas todos de uma vez (atribuio tima)
+                              // em vez de um a um, com a primeira moeda prxima
+    bool roiTracking;         // Processar s regies  volta das posies previstas das moedas seguidas
+    int roiFullFrameInterval; // ... e o frame inteiro a cada N frames (onde aparecem as moedas novas)
+    int roiMargin;            // Margem (px)  volta de cada posio prevista
+    int roiEntryEdges;        // Bordas (ROI_EDGE_*) processadas em todos os frames, por onde entram moedas
+    int roiEntryBand;         // Largura (px) dessas bordas
+    bool changeGating;        // Segmentar s os blocos que mudaram em relao ao modelo de fundo
+                              // (nos outros fica a mscara do frame anterior)
+    int changeThreshold;      // Diferena (0-255, num canal) para um pixel contar como mudado
+    int changeTile;           // Lado dos blocos (px)
+    int changeRefreshInterval;// Segmentar todos os blocos a cada N frames (mudanas lentas)
+    int pyramidFactor;        // > 1: procurar as moedas no frame reduzido (2 ou 4 vezes) e medir a rea e o
+                              // permetro s nessas regies,  resoluo completa (1 = frame inteiro)
+    bool validatePyramid;     // Processar tambm o frame inteiro e reportar as moedas diferentes (pyramidFactor)
+
+    DetectorOptions() : useColourLut(false), colourLutBits(6), validateColourLut(false),
+        morphKernel(3), morphShape(VC_MORPH_SQUARE), packedMorphology(true), threads(0),
+        draw(true), verbose(true), stream(0), assignmentTracker(false), roiTracking(false), roiFullFrameInterval(10),
+        roiMargin(40), roiEntryEdges(0), roiEntryBand(200),
+        changeGating(false), changeThreshold(24), changeTile(32), changeRefreshInterval(30),
+        pyramidFactor(1), validatePyramid(false) {
+    }
+};
+
+// Faixa horizontal do frame, processada por uma tarefa: linhas [y0, y1) e, com a margem de que
+// a abertura e o fecho precisam, [ys, ye). As imagens da faixa tm ye - ys linhas
+struct FrameBand {
+    int y0, y1;
+    int ys, ye;
+    IVC* opened;              // Mscara da faixa aps a abertura
+    IVC* closed;              // Mscara da faixa aps o fecho
+    IVC* temp;                // Imagem auxiliar da abertura/fecho
+    MVC* morph;               // Buffers da morfologia (passagens horizontal/vertical)
+    PVC* packedMask;          // Mscara compacta (1 bit/pixel) da segmentao
+    PVC* packedClosed;        // Mscara compacta aps a abertura e o fecho
+    PVC* packedTemp;          // Mscara compacta auxiliar
+    BVC* background;          // Modelo de fundo das linhas [y0, y1) (criado s com changeGating)
+};
+
+// Regio de interesse de um frame (modo roiTracking), processada por uma tarefa: segmentao,
+// abertura/fecho e etiquetagem s nos pixels da regio. As imagens tm o tamanho da regio e
+// s so realocadas quando ele muda (as regies so arredondadas para tamanhos estveis)
+struct FrameRoi {
+    IVC* mask;
+    IVC* opened;
+    IVC* closed;
+    IVC* temp;
+    MVC* morph;
+    PVC* packedMask;
+    PVC* packedClosed;
+    PVC* packedTemp;
+    LVC* labelling;
+    std::vector<OVC> blobs;   // Blobs inteiros da regio, em coordenadas do frame
+    int cut;                  // Bordas (ROI_EDGE_*) da regio que cortam um blob que pode ser uma moeda
+
+    FrameRoi();
+    bool prepare(int width, int height);
+    void release();
+};
+
+// Espao de trabalho do frame: imagens intermdias alocadas no primeiro frame
+// e reutilizadas nos seguintes (s so realocadas se a resoluo ou as faixas mudarem)
+struct FrameWorkspace {
+    int width;
+    int height;
+    int halo;                 // Linhas de margem de cada faixa (alcance da abertura + fecho)
+    IVC frame_view;           // Vista IVC sem cpia sobre os dados do cv::Mat (BGR)
+    IVC* mask;                // Unio das segmentaes de cor (0/255)
+    IVC* closed;              // Mscara aps a abertura e o fecho
+    std::vector<FrameBand> bands;
+    LVC* labelling;           // Buffers da etiquetagem de blobs e mapa de etiquetas do frame
+    CVC* colourLut;           // Tabela de classificao de cor (criada s se for usada)
+    std::vector<cv::Rect> candidates;     // Caixas dos blobs a seguir (modo de atribuio tima)
+    std::vector<int> assigned;            // Moeda seguida atribuda a cada caixa (-1 = nova)
+    std::vector<cv::Rect> roiRects;       // Regies do frame (modo roiTracking), disjuntas
+    std::vector<FrameRoi> rois;           // Imagens de cada regio (s cresce; roiRects.size() em uso)
+    std::vector<OVC> roiBlobs;            // Blobs de todas as regies
+    IVC* coarse;                          // Frame reduzido (modo pyramidFactor)
+    FrameRoi coarseRoi;                   // Imagens do processamento do frame reduzido
+    Overlay overlay;                      // Desenhos do frame (process_frame sem overlay externo)
+
+    FrameWorkspace();
+    ~FrameWorkspace();
+    FrameWorkspace(const FrameWorkspace&) = delete;
+    FrameWorkspace& operator=(const FrameWorkspace&) = delete;
+
+    bool prepare(int width, int height, int nbands, int halo);
+    void release();
+};
+
+// Funo para criar uma vista IVC (sem cpia) sobre um cv::Mat de 8 bits, mesmo no contnuo
+inline bool mat_to_ivc_view(cv::Mat& mat, IVC* view) {
+    return vc_image_view(view, mat.data, mat.cols, mat.rows, mat.channels(), (int)mat.step) != 0;
+}
+
+// Sesso de deteco de um vdeo (ou cmara): tem o seu seguimento de moedas, as suas contagens e
+// o seu espao de trabalho, por isso vrios detectores podem correr em simultneo no mesmo processo.
+// As faixas de cada frame correm num pool de threads prprio ou partilhado com outros detectores.
+class CoinDetector {
+public:
+    // pool = NULL: cria um pool prprio com options.threads threads
+    explicit CoinDetector(const DetectorOptions& options = DetectorOptions(), ThreadPool* pool = NULL);
+    CoinDetector(const CoinDetector&) = delete;
+    CoinDetector& operator=(const CoinDetector&) = delete;
+
+    // Funo principal para deteco de moedas (frames do mesmo vdeo, por ordem)
+    void process_frame(cv::Mat& frame, int currentFrame);
+    // O mesmo, mas sem desenhar: as caixas e os textos (options.draw) so acrescentados a overlay,
+    // para serem desenhados depois por um OverlayRenderer (por exemplo, na thread da visualizao)
+    void process_frame(cv::Mat& frame, int currentFrame, Overlay& overlay);
+
+    // Recomea a contagem e o seguimento das moedas (novo vdeo)
+    void reset();
+
+    const CoinCounts& counts() const { return coinCount; }
+    int total_coins() const { return TotalCoins; }
+
+    DetectorOptions options;
+
+private:
+    ThreadPool& threads();
+    void plan_rois(int width, int height, int currentFrame);
+    bool plan_coarse_rois(int width, int height);
+    OVC* process_rois(ThreadPool& pool, int* nlabels);
+    void validate_pyramid(ThreadPool& pool, int currentFrame, const OVC* blobs, int nblobs);
+
+    std::unique_ptr<ThreadPool> ownPool;  // Criado s se no houver pool partilhado
+    ThreadPool* sharedPool;
+    FrameWorkspace workspace;
+    OverlayRenderer renderer;             // Desenha workspace.overlay (process_frame sem overlay externo)
+
+    std::vector<CoinTrack> trackedCoins;  // Moedas seguidas entre frames
+    TrackGrid trackGrid;                  // ndice dos centros de trackedCoins (para findMatchingCoin)
+    CoinCounts coinCount;                 // Moedas contadas por denominao
+    int TotalCoins;                       // Total de moedas contadas (todas as denominaes)
+    int nextTrackId;                      // Identificador da prxima moeda seguida (nos registos)
+    int lastFullFrame;                    // ltimo frame processado inteiro (modo roiTracking)
+    int lastRefreshFrame;                 // ltimo frame segmentado em todos os blocos (modo changeGating)
+};
 
 #endif
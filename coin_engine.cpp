@@ -0,0 +1,71 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_ENGINE.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#include "coin_engine.h"
+#include "coin_pipeline.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+CoinEngine::CoinEngine(const DetectorOptions& options, int nthreads) : options(options), pool(nthreads) {
+}
+
+void CoinEngine::add_stream(const std::string& source) {
+    sources.push_back(source);
+}
+
+void CoinEngine::run() {
+    std::vector<std::thread> streams;
+
+    streamResults.assign(sources.size(), StreamResult());
+
+    // Uma thread por vdeo s para o conduzir (passa a maior parte do tempo  espera);
+    // o trabalho pesado de cada frame vai para o pool partilhado
+    for (size_t i = 0; i < sources.size(); i++) streams.emplace_back(&CoinEngine::run_stream, this, (int)i);
+    for (std::thread& t : streams) t.join();
+}
+
+void CoinEngine::run_stream(int index) {
+    StreamResult& result = streamResults[index];
+    cv::VideoCapture capture;
+
+    result.source = sources[index];
+
+    capture.open(result.source);
+    if (!capture.isOpened()) {
+        std::cerr << "Erro ao abrir o ficheiro de vdeo: " << result.source << std::endl;
+        return;
+    }
+    result.opened = true;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    DetectorOptions streamOptions = options;
+    streamOptions.stream = index;
+
+    CoinDetector detector(streamOptions, &pool);
+    FramePipeline pipeline(capture, (int)capture.get(cv::CAP_PROP_FPS), detector);
+    pipeline.start();
+
+    // Sem visualizao: os frames voltam logo para a leitura
+    PipelineFrame* processed;
+    while ((processed = pipeline.next()) != NULL) {
+        result.frames++;
+        pipeline.release(processed);
+    }
+
+    pipeline.stop();
+    result.dropped = pipeline.dropped();
+    capture.release();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.counts = detector.counts();
+    result.total = detector.total_coins();
+}
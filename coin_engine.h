@@ -0,0 +1,58 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_ENGINE.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_ENGINE_H
+#define COIN_ENGINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coin_detector.h"
+#include "coin_threads.h"
+
+// Resultado de um vdeo processado pelo motor
+struct StreamResult {
+    std::string source;
+    bool opened;              // false se no foi possvel abrir o vdeo
+    long frames;              // Frames processados
+    long dropped;             // Frames descartados com o detector atrasado (pipelineOptions.dropFrames)
+    double seconds;           // Tempo de processamento do vdeo
+    CoinCounts counts;        // Moedas contadas por denominao
+    int total;                // Total de moedas contadas
+
+    StreamResult() : opened(false), frames(0), dropped(0), seconds(0), total(0) {
+        counts.fill(0);
+    }
+};
+
+// Motor de vrios vdeos em simultneo: cada vdeo tem o seu detector (seguimento e contagens
+// independentes) e o seu pipeline de leitura/deteo; as faixas de todos os frames correm num s
+// pool de threads partilhado
+class CoinEngine {
+public:
+    CoinEngine(const DetectorOptions& options, int nthreads);   // nthreads = 0: nmero de ncleos
+
+    void add_stream(const std::string& source);
+
+    // Processa todos os vdeos em simultneo e s retorna quando todos terminarem
+    void run();
+
+    const std::vector<StreamResult>& results() const { return streamResults; }
+
+private:
+    void run_stream(int index);
+
+    DetectorOptions options;
+    ThreadPool pool;
+    std::vector<std::string> sources;
+    std::vector<StreamResult> streamResults;
+};
+
+#endif
@@ -0,0 +1,208 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_LOG.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "coin_log.h"
+#include <algorithm>
+
+EventLog eventLog;
+
+static const char* const LEVEL_NAMES[] = { "debug", "info", "warn", "error" };
+static const char* const EVENT_NAMES[] = { "colour", "confirmed", "counted" };
+
+EventLog::EventLog(int capacity) : mask(0), enqueuePos(0), dequeuePos(0), written(0), running(false),
+    stopping(false), droppedEvents(0), minLevel(LOG_DEBUG), format(LOG_TEXT), file(NULL), ownFile(false) {
+    size_t size = 1;
+    while (size < (size_t)std::max(capacity, 2)) size *= 2;
+
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+EventLog::~EventLog() {
+    stop();
+}
+
+bool EventLog::start(const char* path, LogFormat format, LogLevel level) {
+    stop();
+
+    if (path != NULL) {
+        file = fopen(path, format == LOG_BINARY ? "wb" : "w");
+        if (file == NULL) return false;
+        ownFile = true;
+    }
+    else {
+        file = stdout;
+        ownFile = false;
+    }
+
+    if (format == LOG_BINARY) {
+        uint32_t size = sizeof(LogEvent);
+        fwrite("VCLOG1", 1, 6, file);
+        fwrite(&size, sizeof(size), 1, file);
+    }
+
+    this->format = format;
+    minLevel = level;
+    start_time = std::chrono::steady_clock::now();
+    stopping.store(false);
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&EventLog::writer, this);
+    return true;
+}
+
+void EventLog::stop() {
+    if (!thread.joinable()) return;
+
+    // Os eventos registados antes disto ainda so escritos
+    running.store(false, std::memory_order_release);
+    stopping.store(true);
+    thread.join();
+
+    if (ownFile) fclose(file);
+    else fflush(file);
+    file = NULL;
+}
+
+void EventLog::flush() {
+    size_t target = enqueuePos.load();
+    int spins = 0;
+
+    while (thread.joinable() && written.load() < target) {
+        if (++spins < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+// Fila limitada de vrios produtores (posies reservadas com compare_exchange) e um consumidor:
+// cada posio tem um nmero de sequncia que diz se est livre para a volta atual do buffer
+void EventLog::push(LogLevel level, LogEvent& event) {
+    event.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+    event.level = (uint8_t)level;
+
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+        slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            // Buffer cheio: a thread de escrita est atrasada
+            droppedEvents++;
+            return;
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->event = event;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Thread de escrita: esvazia o buffer e, quando no h eventos, despeja o ficheiro e espera um pouco
+void EventLog::writer() {
+    int spins = 0;
+
+    for (;;) {
+        Slot& slot = slots[dequeuePos & mask];
+
+        if (slot.sequence.load(std::memory_order_acquire) == dequeuePos + 1) {
+            write(slot.event);
+            slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+            dequeuePos++;
+            spins = 0;
+
+            // Com o buffer vazio, os eventos escritos ficam logo visveis (flush)
+            if (slots[dequeuePos & mask].sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                fflush(file);
+                written.store(dequeuePos);
+            }
+            continue;
+        }
+
+        // Posio reservada mas ainda a ser copiada: espera por ela, mesmo ao terminar
+        if (dequeuePos < enqueuePos.load()) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        fflush(file);
+        written.store(dequeuePos);
+        if (stopping.load()) return;
+
+        if (++spins < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+void EventLog::write(const LogEvent& e) {
+    if (format == LOG_BINARY) {
+        fwrite(&e, sizeof(e), 1, file);
+        return;
+    }
+
+    if (format == LOG_JSON) {
+        fprintf(file, "{\"t\":%lld,\"level\":\"%s\",\"event\":\"%s\",\"stream\":%d,\"frame\":%d,\"track\":%d",
+            (long long)e.time, LEVEL_NAMES[e.level], EVENT_NAMES[e.kind], e.stream, e.frame, e.track);
+
+        switch (e.kind) {
+        case EVENT_COLOUR:
+            fprintf(file, ",\"colour\":\"%s\",\"hsv\":[%d,%d,%d],\"ring_colour\":\"%s\",\"ring_hsv\":[%d,%d,%d]",
+                colour_name((CoinColour)e.colour), e.hsv[0], e.hsv[1], e.hsv[2],
+                colour_name((CoinColour)e.ringColour), e.ringHsv[0], e.ringHsv[1], e.ringHsv[2]);
+            break;
+        case EVENT_CONFIRMED:
+        case EVENT_COUNTED:
+            fprintf(file, ",\"type\":\"%s\",\"area\":%d,\"perimeter\":%d,\"circularity\":%g",
+                coin_name((CoinType)e.type), e.area, e.perimeter, e.circularity);
+            if (e.kind == EVENT_COUNTED) fprintf(file, ",\"count\":%d", e.count);
+            else {
+                fprintf(file, ",\"areas\":[");
+                for (int j = 0; j < STABILITY_THRESHOLD; j++) fprintf(file, j ? ",%d" : "%d", e.areaHistory[j]);
+                fprintf(file, "],\"perimeters\":[");
+                for (int j = 0; j < STABILITY_THRESHOLD; j++) fprintf(file, j ? ",%d" : "%d", e.perimeterHistory[j]);
+                fprintf(file, "]");
+            }
+            break;
+        }
+        fprintf(file, "}\n");
+        return;
+    }
+
+    // Texto: as mensagens que o detector escrevia diretamente no stdout
+    switch (e.kind) {
+    case EVENT_COLOUR:
+        fprintf(file, "Cor do centro: %s (H:%d S:%d V:%d) Anel: %s (H:%d S:%d V:%d)\n",
+            colour_name((CoinColour)e.colour), e.hsv[0], e.hsv[1], e.hsv[2],
+            colour_name((CoinColour)e.ringColour), e.ringHsv[0], e.ringHsv[1], e.ringHsv[2]);
+        break;
+    case EVENT_CONFIRMED:
+        fprintf(file, "=== MOEDA CONFIRMADA ===\nFrame: %d\nTipo: %s\nrea final: %d\nPermetro final: %d\n"
+            "Circularidade final: %g\n", e.frame, coin_name((CoinType)e.type), e.area, e.perimeter, e.circularity);
+        fprintf(file, "Histrico de reas: ");
+        for (int j = 0; j < STABILITY_THRESHOLD; j++) fprintf(file, "%d ", e.areaHistory[j]);
+        fprintf(file, "\nHistrico de permetros: ");
+        for (int j = 0; j < STABILITY_THRESHOLD; j++) fprintf(file, "%d ", e.perimeterHistory[j]);
+        fprintf(file, "\n========================\n");
+        break;
+    case EVENT_COUNTED:
+        fprintf(file, ">>> MOEDA CONTADA: %s (Total: %d, rea: %d, Permetro: %d, Circularidade: %g)\n",
+            coin_name((CoinType)e.type), e.count, e.area, e.perimeter, e.circularity);
+        break;
+    }
+}
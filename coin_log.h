@@ -0,0 +1,108 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_LOG.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_LOG_H
+#define COIN_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "coin_utils.h"
+
+// Nveis dos registos (s so registados os do nvel mnimo para cima)
+enum LogLevel { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
+
+// Formato do ficheiro de registos
+enum LogFormat {
+    LOG_TEXT,                 // As mensagens de sempre, legveis (por omisso no stdout)
+    LOG_JSON,                 // Um objeto JSON por linha, com os campos do evento
+    LOG_BINARY                // Cabealho "VCLOG1" + tamanho do evento (uint32), seguidos dos LogEvent tal como esto em memria
+};
+
+// Tipos de evento
+enum LogEventKind {
+    EVENT_COLOUR,             // Cor do centro e do anel de um blob correspondido a uma moeda seguida
+    EVENT_CONFIRMED,          // Tipo de uma moeda confirmado (rea estvel)
+    EVENT_COUNTED             // Moeda contada
+};
+
+// Evento de tamanho fixo, sem ponteiros nem texto:  copiado para o buffer circular e s 
+// formatado na thread de escrita. Os campos que no se aplicam ao tipo de evento ficam a 0
+struct LogEvent {
+    int64_t time;             // Nanossegundos desde o incio do registo
+    uint8_t level;            // LogLevel
+    uint8_t kind;             // LogEventKind
+    int16_t stream;           // Vdeo (DetectorOptions::stream)
+    int32_t frame;
+    int32_t track;            // Identificador da moeda seguida (CoinTrack::id)
+    int32_t type;             // CoinType (CONFIRMED, COUNTED)
+    int32_t count;            // COUNTED: moedas desse tipo contadas at agora
+    int32_t area, perimeter;  // CONFIRMED, COUNTED: rea e permetro finais
+    float circularity;
+    uint8_t colour, ringColour;   // COLOUR: CoinColour do centro e do anel
+    uint8_t hsv[3], ringHsv[3];   // COLOUR: HSV mdio do centro e do anel
+    int32_t areaHistory[STABILITY_THRESHOLD];       // CONFIRMED
+    int32_t perimeterHistory[STABILITY_THRESHOLD];  // CONFIRMED
+};
+
+// Registo de eventos assncrono: quem regista (as threads de deteo, uma por vdeo) s copia o
+// evento para um buffer circular sem locks (vrias threads a escrever, uma a ler); uma thread
+// prpria formata e escreve no ficheiro. Com o buffer cheio o evento  descartado e contado
+// (quem regista nunca espera pela escrita)
+class EventLog {
+public:
+    explicit EventLog(int capacity = 8192);   // Arredondada para uma potncia de 2
+    ~EventLog();
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    // path = NULL: stdout. Devolve false se no conseguir abrir o ficheiro
+    bool start(const char* path, LogFormat format, LogLevel level);
+    void stop();              // Escreve o que falta e termina a thread de escrita
+    void flush();             // Espera at todos os eventos j registados estarem escritos
+
+    bool enabled(LogLevel level) const { return running.load(std::memory_order_acquire) && level >= minLevel; }
+    void push(LogLevel level, LogEvent& event);   // Preenche time e level antes de copiar
+
+    long dropped() const { return droppedEvents.load(); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;   // Posio  espera de escrita (== pos) ou de leitura (== pos + 1)
+        LogEvent event;
+    };
+
+    void writer();
+    void write(const LogEvent& event);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;        // S a thread de escrita
+    std::atomic<size_t> written;          // Eventos j escritos (para flush)
+
+    std::atomic<bool> running;
+    std::atomic<bool> stopping;
+    std::atomic<long> droppedEvents;
+    int minLevel;
+    LogFormat format;
+    FILE* file;
+    bool ownFile;
+    std::chrono::steady_clock::time_point start_time;
+    std::thread thread;
+};
+
+// Registo usado pelos detectores (iniciado em main)
+extern EventLog eventLog;
+
+#endif
@@ -0,0 +1,165 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_OVERLAY.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#include "coin_overlay.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// Textos diferentes guardados no renderer antes de a cache ser esvaziada (textos que afinal variam)
+static const size_t MAX_CACHED_TEXTS = 256;
+
+void Overlay::box(const cv::Rect& rect, cv::Vec3b colour, int thickness) {
+    commands.push_back({ BOX, rect, colour, cv::Scalar(), thickness, 0.0, 0, 0 });
+}
+
+void Overlay::fill(const cv::Rect& rect, cv::Vec3b colour) {
+    commands.push_back({ FILL, rect, colour, cv::Scalar(), 0, 0.0, 0, 0 });
+}
+
+void Overlay::text(cv::Point origin, double scale, cv::Scalar colour, int thickness, bool cached, const char* format, ...) {
+    va_list args;
+    size_t first = chars.size();
+    int length;
+
+    // Formata diretamente no fim de chars (com espao para o '\0' do vsnprintf)
+    chars.resize(first + 64);
+    va_start(args, format);
+    length = vsnprintf(&chars[first], 64, format, args);
+    va_end(args);
+    if (length < 0) length = 0;
+    if (length >= 64) {
+        chars.resize(first + length + 1);
+        va_start(args, format);
+        vsnprintf(&chars[first], length + 1, format, args);
+        va_end(args);
+    }
+    chars.resize(first + length);
+
+    commands.push_back({ cached ? CACHED_TEXT : TEXT, cv::Rect(origin.x, origin.y, 0, 0), cv::Vec3b(), colour,
+        thickness, scale, first, (size_t)length });
+}
+
+// Preenche os pixels [x0, x1) de uma linha BGR: cinzentos com memset, as outras cores
+// duplicando o segmento j escrito (memcpy de 1, 2, 4, ... pixels)
+static void fill_span(uchar* row, int x0, int x1, cv::Vec3b colour) {
+    if (x1 <= x0) return;
+
+    uchar* p = row + 3 * x0;
+    size_t n = 3 * (size_t)(x1 - x0);
+
+    if (colour[0] == colour[1] && colour[1] == colour[2]) {
+        memset(p, colour[0], n);
+        return;
+    }
+
+    p[0] = colour[0];
+    p[1] = colour[1];
+    p[2] = colour[2];
+    for (size_t done = 3; done < n; done *= 2) memcpy(p + done, p, std::min(done, n - done));
+}
+
+// Contorno com a espessura para dentro, com os mesmos pixels que drawRectangleManual desenhava um a
+// um: thickness linhas inteiras em cima e em baixo, e thickness colunas de cada lado (segmentos curtos)
+static void render_box(cv::Mat& frame, const cv::Rect& rect, cv::Vec3b colour, int thickness) {
+    int x0 = std::max(rect.x, 0), x1 = std::min(rect.x + rect.width, frame.cols);
+    int top = rect.y, bottom = rect.y + rect.height - thickness;
+
+    for (int t = 0; t < thickness; t++) {
+        if (top + t >= 0 && top + t < frame.rows) fill_span(frame.ptr<uchar>(top + t), x0, x1, colour);
+        if (bottom + t >= 0 && bottom + t < frame.rows) fill_span(frame.ptr<uchar>(bottom + t), x0, x1, colour);
+    }
+
+    int left0 = std::max(rect.x, 0), left1 = std::min(rect.x + thickness, frame.cols);
+    int right0 = std::max(rect.x + rect.width - thickness, 0), right1 = std::min(rect.x + rect.width, frame.cols);
+
+    for (int y = std::max(rect.y, 0); y < std::min(rect.y + rect.height, frame.rows); y++) {
+        uchar* row = frame.ptr<uchar>(y);
+        fill_span(row, left0, left1, colour);
+        fill_span(row, right0, right1, colour);
+    }
+}
+
+static void render_fill(cv::Mat& frame, const cv::Rect& rect, cv::Vec3b colour) {
+    int y0 = std::max(rect.y, 0), y1 = std::min(rect.y + rect.height, frame.rows);
+    int x0 = std::max(rect.x, 0), x1 = std::min(rect.x + rect.width, frame.cols);
+
+    for (int y = y0; y < y1; y++) fill_span(frame.ptr<uchar>(y), x0, x1, colour);
+}
+
+const OverlayRenderer::GlyphStrip& OverlayRenderer::strip(const char* chars, size_t length, double scale, int thickness) {
+    key.assign(chars, length);
+    key.append((const char*)&scale, sizeof(scale));
+    key.append((const char*)&thickness, sizeof(thickness));
+
+    auto found = cache.find(key);
+    if (found != cache.end()) return found->second;
+
+    if (cache.size() >= MAX_CACHED_TEXTS) cache.clear();
+
+    // Rasteriza o texto numa mscara com margem para a espessura e as letras abaixo da linha de base
+    int baseline = 0;
+    text.assign(chars, length);
+    cv::Size size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, scale, thickness, &baseline);
+    int margin = thickness + 2;
+    cv::Point origin(margin, margin + size.height);
+
+    raster.create(size.height + baseline + 2 * margin, size.width + 2 * margin, CV_8UC1);
+    raster.setTo(cv::Scalar(0));
+    cv::putText(raster, text, origin, cv::FONT_HERSHEY_SIMPLEX, scale, cv::Scalar(255), thickness);
+
+    GlyphStrip& glyphs = cache[key];
+    for (int y = 0; y < raster.rows; y++) {
+        const uchar* row = raster.ptr<uchar>(y);
+        for (int x = 0; x < raster.cols; x++) {
+            if (row[x] == 0) continue;
+            int x0 = x;
+            while (x < raster.cols && row[x] != 0) x++;
+            glyphs.spans.push_back({ (short)(y - origin.y), (short)(x0 - origin.x), (short)(x - origin.x) });
+        }
+    }
+
+    return glyphs;
+}
+
+void OverlayRenderer::render(const Overlay& overlay, cv::Mat& frame) {
+    for (const Overlay::Command& command : overlay.commands) {
+        switch (command.kind) {
+        case Overlay::BOX:
+            render_box(frame, command.rect, command.colour, command.thickness);
+            break;
+
+        case Overlay::FILL:
+            render_fill(frame, command.rect, command.colour);
+            break;
+
+        case Overlay::TEXT:
+            text.assign(overlay.chars.data() + command.first, command.length);
+            cv::putText(frame, text, cv::Point(command.rect.x, command.rect.y), cv::FONT_HERSHEY_SIMPLEX,
+                command.scale, command.textColour, command.thickness);
+            break;
+
+        case Overlay::CACHED_TEXT: {
+            const GlyphStrip& glyphs = strip(overlay.chars.data() + command.first, command.length, command.scale, command.thickness);
+            cv::Vec3b colour(cv::saturate_cast<uchar>(command.textColour[0]), cv::saturate_cast<uchar>(command.textColour[1]),
+                cv::saturate_cast<uchar>(command.textColour[2]));
+
+            for (const Span& span : glyphs.spans) {
+                int y = command.rect.y + span.y;
+                if (y < 0 || y >= frame.rows) continue;
+                fill_span(frame.ptr<uchar>(y), std::max(command.rect.x + span.x0, 0),
+                    std::min(command.rect.x + span.x1, frame.cols), colour);
+            }
+            break;
+        }
+        }
+    }
+}
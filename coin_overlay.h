@@ -0,0 +1,79 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_OVERLAY.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_OVERLAY_H
+#define COIN_OVERLAY_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Comandos de desenho de um frame (caixas, centros e textos), registados durante a deteo e
+// desenhados depois, de uma vez, por um OverlayRenderer (na mesma thread ou na da visualizao).
+// Os buffers so reutilizados de frame para frame: depois do primeiro, registar no aloca memria
+class Overlay {
+public:
+    Overlay() {}
+
+    void clear() { commands.clear(); chars.clear(); }
+    bool empty() const { return commands.empty(); }
+
+    // Contorno de rect com thickness pixels de espessura, para dentro do retngulo
+    void box(const cv::Rect& rect, cv::Vec3b colour, int thickness);
+    // Retngulo cheio
+    void fill(const cv::Rect& rect, cv::Vec3b colour);
+    // Texto formatado como no printf, na origem (canto inferior esquerdo) de cv::putText.
+    // cached: texto que se repete entre frames (cabealhos, tipos, contagens), desenhado a partir
+    // das linhas j rasterizadas no renderer
+    void text(cv::Point origin, double scale, cv::Scalar colour, int thickness, bool cached, const char* format, ...);
+
+private:
+    friend class OverlayRenderer;
+
+    enum Kind { BOX, FILL, TEXT, CACHED_TEXT };
+
+    struct Command {
+        Kind kind;
+        cv::Rect rect;            // BOX/FILL: retngulo; TEXT: origem em (x, y)
+        cv::Vec3b colour;         // BOX/FILL
+        cv::Scalar textColour;    // TEXT
+        int thickness;
+        double scale;
+        size_t first, length;     // Texto em chars[first, first + length)
+    };
+
+    std::vector<Command> commands;
+    std::vector<char> chars;      // Textos de todos os comandos, seguidos
+};
+
+// Desenha os comandos de um Overlay sobre o frame. As caixas e os retngulos so preenchidos linha a
+// linha (segmentos contguos, como um memset); os textos marcados como cached so rasterizados uma s
+// vez (cv::putText numa mscara) e guardados como segmentos por linha, copiados depois para cada frame.
+// Cada thread que desenha tem o seu renderer
+class OverlayRenderer {
+public:
+    OverlayRenderer() {}
+
+    void render(const Overlay& overlay, cv::Mat& frame);
+
+private:
+    // Texto rasterizado: segmentos [x0, x1) da linha y, relativos  origem do texto
+    struct Span { short y, x0, x1; };
+    struct GlyphStrip { std::vector<Span> spans; };
+
+    const GlyphStrip& strip(const char* text, size_t length, double scale, int thickness);
+
+    std::unordered_map<std::string, GlyphStrip> cache;
+    std::string key;              // Chave da procura (reutilizada)
+    std::string text;             // Texto para cv::putText (reutilizado)
+    cv::Mat raster;               // Mscara onde os textos so rasterizados
+};
+
+#endif
@@ -0,0 +1,150 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_PIPELINE.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#include "coin_pipeline.h"
+#include "coin_detector.h"
+#include "coin_profile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+PipelineOptions pipelineOptions;
+
+// Espera ativa curta e depois a dormir, para uma etapa parada no ocupar um ncleo
+static void pipeline_wait(int& spins) {
+    if (++spins < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+FramePipeline::FramePipeline(cv::VideoCapture& capture, int fps, CoinDetector& detector) :
+    capture(capture), fps(fps), detector(detector),
+    // Um frame a ser lido, um na deteo e um na visualizao, alm dos que esperam nas filas
+    frames(2 * std::max(pipelineOptions.queueSize, 1) + 3),
+    freeFrames((int)frames.size()), decoded(std::max(pipelineOptions.queueSize, 1)),
+    detected(std::max(pipelineOptions.queueSize, 1)),
+    stopping(false), decodeDone(false), detectDone(false), droppedFrames(0) {
+
+    for (PipelineFrame& frame : frames) freeFrames.push(&frame);
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+}
+
+void FramePipeline::start() {
+    decodeThread = std::thread(&FramePipeline::decode, this);
+    detectThread = std::thread(&FramePipeline::detect, this);
+}
+
+void FramePipeline::stop() {
+    stopping.store(true);
+    if (decodeThread.joinable()) decodeThread.join();
+    if (detectThread.joinable()) detectThread.join();
+}
+
+// Etapa de leitura: descodifica os frames para buffers livres e passa-os  deteo
+void FramePipeline::decode() {
+    auto start = std::chrono::steady_clock::now();
+    long nread = 0;
+    PipelineFrame* frame = NULL;
+
+    while (!stopping.load()) {
+        int spins = 0;
+        while (frame == NULL && !freeFrames.pop(frame)) {
+            if (stopping.load()) break;
+            pipeline_wait(spins);
+        }
+        if (frame == NULL) break;
+
+        // Como uma cmara: o frame n s est disponvel no instante n / fps (em 64 bits: long
+        // tem 32 bits no MSVC e nread * 1000000 passaria o limite ao fim de 2147 frames)
+        if (pipelineOptions.dropFrames && fps > 0) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t)nread * 1000000 / fps));
+        }
+
+        bool ok;
+        {
+            PROFILE_SCOPE(PROFILE_DECODE);
+            ok = capture.read(frame->image) && !frame->image.empty();
+        }
+        if (!ok) break;
+        frame->number = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
+        nread++;
+
+        if (pipelineOptions.dropFrames) {
+            // Detector atrasado: o frame  descartado e o buffer serve para o seguinte
+            if (!decoded.push(frame)) {
+                droppedFrames++;
+                continue;
+            }
+        }
+        else {
+            spins = 0;
+            while (!decoded.push(frame)) {
+                if (stopping.load()) break;
+                pipeline_wait(spins);
+            }
+        }
+        frame = NULL;
+    }
+
+    // Um buffer que sobre fica fora de circulao (frames  dono dele): devolv-lo a freeFrames
+    // daria dois produtores  fila, com release() na thread da visualizao
+    decodeDone.store(true);
+}
+
+// Etapa de deteo: processa os frames pela ordem de leitura (desenha sobre o prprio frame,
+// ou deixa os desenhos no overlay do frame com overlayOnDisplay)
+void FramePipeline::detect() {
+    PipelineFrame* frame;
+
+    while (!stopping.load()) {
+        int spins = 0;
+        while (!decoded.pop(frame)) {
+            if (stopping.load() || (decodeDone.load() && decoded.empty())) {
+                detectDone.store(true);
+                return;
+            }
+            pipeline_wait(spins);
+        }
+
+        frame->overlay.clear();
+        detector.process_frame(frame->image, frame->number, frame->overlay);
+        if (!pipelineOptions.overlayOnDisplay) {
+            PROFILE_SCOPE(PROFILE_RENDER);
+            renderer.render(frame->overlay, frame->image);
+            frame->overlay.clear();
+        }
+
+        spins = 0;
+        while (!detected.push(frame)) {
+            if (stopping.load()) break;
+            pipeline_wait(spins);
+        }
+    }
+
+    detectDone.store(true);
+}
+
+PipelineFrame* FramePipeline::next() {
+    PipelineFrame* frame;
+    int spins = 0;
+
+    while (!detected.pop(frame)) {
+        if (stopping.load() || (detectDone.load() && detected.empty())) return NULL;
+        pipeline_wait(spins);
+    }
+
+    return frame;
+}
+
+void FramePipeline::release(PipelineFrame* frame) {
+    if (frame != NULL) freeFrames.push(frame);
+}
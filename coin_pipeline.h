@@ -0,0 +1,120 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_PIPELINE.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_PIPELINE_H
+#define COIN_PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "coin_overlay.h"
+
+class CoinDetector;
+
+// Fila circular limitada, sem locks, para um s produtor e um s consumidor
+// head s  escrito pelo consumidor e tail s pelo produtor
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(int capacity) : slots(capacity + 1), head(0), tail(0) {}
+
+    // Produtor: devolve false se a fila estiver cheia
+    bool push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire)) return false;
+        slots[t] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumidor: devolve false se a fila estiver vazia
+    bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = slots[h];
+        head.store((h + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+// Opes do pipeline
+struct PipelineOptions {
+    int queueSize;            // Frames em espera entre cada par de etapas
+    bool dropFrames;          // Ler o vdeo ao ritmo do fps (como uma cmara) e descartar os frames
+                              // que chegam com o detector atrasado (a fila para o detector cheia)
+    bool overlayOnDisplay;    // Deixar os desenhos da deteo em PipelineFrame::overlay, para a visualizao
+                              // os desenhar (em vez de os desenhar logo na thread da deteo)
+
+    PipelineOptions() : queueSize(4), dropFrames(false), overlayOnDisplay(false) {
+    }
+};
+
+extern PipelineOptions pipelineOptions;
+
+// Frame em circulao no pipeline (os buffers so reutilizados: leitura -> deteo -> visualizao -> leitura)
+struct PipelineFrame {
+    cv::Mat image;
+    int number;               // Nmero do frame no vdeo
+    Overlay overlay;          // Desenhos ainda por fazer sobre image (vazio sem overlayOnDisplay)
+};
+
+// Pipeline de trs etapas para um vdeo: leitura e deteo em threads prprias; a visualizao
+// (imshow/waitKey, que tm de ficar na thread principal) consome os frames j processados com next()
+class FramePipeline {
+public:
+    FramePipeline(cv::VideoCapture& capture, int fps, CoinDetector& detector);
+    ~FramePipeline();
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    void start();
+    void stop();                          // Pede s etapas que terminem e espera por elas
+
+    PipelineFrame* next();                // Prximo frame processado (por ordem), ou NULL no fim do vdeo
+    void release(PipelineFrame* frame);   // Devolve o frame  leitura depois de visualizado
+
+    long dropped() const { return droppedFrames.load(); }
+
+private:
+    void decode();
+    void detect();
+
+    cv::VideoCapture& capture;
+    int fps;
+    CoinDetector& detector;
+
+    std::vector<PipelineFrame> frames;
+    SpscQueue<PipelineFrame*> freeFrames;     // Visualizao -> leitura
+    SpscQueue<PipelineFrame*> decoded;        // Leitura -> deteo
+    SpscQueue<PipelineFrame*> detected;       // Deteo -> visualizao
+
+    std::atomic<bool> stopping;
+    std::atomic<bool> decodeDone;
+    std::atomic<bool> detectDone;
+    std::atomic<long> droppedFrames;
+
+    OverlayRenderer renderer;             // Desenha os overlays na thread da deteo
+
+    std::thread decodeThread;
+    std::thread detectThread;
+};
+
+#endif
@@ -0,0 +1,132 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_PROFILE.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "coin_profile.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifndef COIN_NO_PROFILE
+
+static const char* const STAGE_NAMES[N_PROFILE_STAGES] = { "leitura", "deteo", "segmentao", "morfologia",
+    "etiquetagem", "regies", "seguimento", "desenho", "janela" };
+
+LatencyHistogram profileHistograms[N_PROFILE_STAGES];
+
+// Posio do bit mais significativo (v > 0)
+static int highest_bit(uint64_t v) {
+    int bit = 0;
+
+    if (v >> 32) { v >>= 32; bit += 32; }
+    if (v >> 16) { v >>= 16; bit += 16; }
+    if (v >> 8) { v >>= 8; bit += 8; }
+    if (v >> 4) { v >>= 4; bit += 4; }
+    if (v >> 2) { v >>= 2; bit += 2; }
+    if (v >> 1) bit += 1;
+    return bit;
+}
+
+// Balde de um valor: abaixo de SUB_BUCKETS, o prprio valor; acima, os SUB_BITS bits a seguir
+// ao mais significativo escolhem um dos SUB_BUCKETS baldes dessa potncia de 2
+static int bucket_of(uint64_t v) {
+    if (v < (uint64_t)LatencyHistogram::SUB_BUCKETS) return (int)v;
+
+    int shift = highest_bit(v) - LatencyHistogram::SUB_BITS;
+    return LatencyHistogram::SUB_BUCKETS * (shift + 1) + (int)(v >> shift) - LatencyHistogram::SUB_BUCKETS;
+}
+
+// Maior valor que cai no balde
+static int64_t bucket_limit(int bucket) {
+    if (bucket < LatencyHistogram::SUB_BUCKETS) return bucket;
+
+    int shift = bucket / LatencyHistogram::SUB_BUCKETS - 1;
+    int64_t mantissa = LatencyHistogram::SUB_BUCKETS + bucket % LatencyHistogram::SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t v = ns < 0 ? 0 : (uint64_t)ns;
+    if (v >= ((uint64_t)1 << MAX_BITS)) v = ((uint64_t)1 << MAX_BITS) - 1;
+
+    buckets[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add((int64_t)v, std::memory_order_relaxed);
+
+    int64_t seen = maxValue.load(std::memory_order_relaxed);
+    while ((int64_t)v > seen && !maxValue.compare_exchange_weak(seen, (int64_t)v, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+    samples.store(0);
+    total.store(0);
+    maxValue.store(0);
+}
+
+double LatencyHistogram::mean() const {
+    long n = count();
+    return n > 0 ? (double)total.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    long n = count();
+    if (n == 0) return 0;
+
+    // Posio (a partir de 1) da amostra do percentil
+    long rank = (long)(p / 100.0 * n + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+
+    long seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucket_limit(i), max());
+    }
+    return max();
+}
+
+void profile_dump(std::ostream& out) {
+    char line[128];
+
+    out << "\n-- TEMPOS POR ETAPA (ms) --" << std::endl;
+    snprintf(line, sizeof(line), "%-14s %8s %9s %9s %9s %9s", "etapa", "n", "media", "p50", "p99", "max");
+    out << line << std::endl;
+
+    for (int stage = 0; stage < N_PROFILE_STAGES; stage++) {
+        const LatencyHistogram& h = profileHistograms[stage];
+        if (h.count() == 0) continue;
+
+        // Os nomes tm acentos: o alinhamento  feito  mo, pelo nmero de carateres
+        out << STAGE_NAMES[stage];
+        int chars = 0;
+        for (const char* c = STAGE_NAMES[stage]; *c; c++) chars += ((*c & 0xC0) != 0x80);
+        for (; chars < 15; chars++) out << ' ';
+
+        snprintf(line, sizeof(line), "%8ld %9.3f %9.3f %9.3f %9.3f", h.count(), h.mean() / 1e6,
+            h.percentile(50) / 1e6, h.percentile(99) / 1e6, h.max() / 1e6);
+        out << line << std::endl;
+    }
+}
+
+void profile_reset() {
+    for (LatencyHistogram& h : profileHistograms) h.reset();
+}
+
+#else
+
+void profile_dump(std::ostream& out) {
+    out << "\n-- TEMPOS POR ETAPA: compilado com COIN_NO_PROFILE --" << std::endl;
+}
+
+void profile_reset() {
+}
+
+#endif
@@ -0,0 +1,98 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_PROFILE.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_PROFILE_H
+#define COIN_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Tempos por etapa: cada PROFILE_SCOPE(etapa) mede (steady_clock) o tempo at ao fim do bloco e
+// junta-o ao histograma da etapa (de todos os vdeos e threads). Com COIN_NO_PROFILE definido,
+// PROFILE_SCOPE no gera cdigo nenhum
+
+// Etapas medidas
+enum ProfileStage {
+    PROFILE_DECODE,           // Leitura do frame (cv::VideoCapture::read)
+    PROFILE_FRAME,            // process_frame inteiro (sem desenhar)
+    PROFILE_SEGMENT,          // Converso HSV e segmentao das trs cores (todas as faixas)
+    PROFILE_MORPH,            // Abertura e fecho (todas as faixas)
+    PROFILE_LABEL,            // Etiquetagem dos blobs
+    PROFILE_ROIS,             // Segmentao, morfologia e etiquetagem s nas regies (roiTracking, pyramidFactor)
+    PROFILE_TRACK,            // Correspondncia, classificao e contagem das moedas
+    PROFILE_RENDER,           // Desenho do overlay sobre o frame
+    PROFILE_DISPLAY,          // cv::imshow e cv::waitKey
+    N_PROFILE_STAGES
+};
+
+#ifndef COIN_NO_PROFILE
+
+// Histograma de latncias com baldes logartmico-lineares (como o HdrHistogram): valores at 32 ns
+// exatos e, acima disso, 32 baldes por potncia de 2 (erro relativo < 3,2%), at ~37 minutos.
+// record()  s um fetch_add (pode ser chamado de vrias threads ao mesmo tempo)
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_BITS = 41;                       // Valores at 2^41 - 1 ns
+    static const int BUCKETS = SUB_BUCKETS + (MAX_BITS - SUB_BITS) * SUB_BUCKETS;
+
+    LatencyHistogram() { reset(); }
+
+    void record(int64_t ns);
+    void reset();
+
+    long count() const { return samples.load(std::memory_order_relaxed); }
+    int64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+    double mean() const;
+    int64_t percentile(double p) const;   // Limite superior do balde do percentil p (0-100)
+
+private:
+    std::atomic<uint32_t> buckets[BUCKETS];
+    std::atomic<long> samples;
+    std::atomic<int64_t> total;
+    std::atomic<int64_t> maxValue;
+};
+
+extern LatencyHistogram profileHistograms[N_PROFILE_STAGES];
+
+// Mede o tempo de vida do objeto (um bloco) e junta-o ao histograma da etapa
+class ScopedTimer {
+public:
+    explicit ScopedTimer(ProfileStage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        profileHistograms[stage].record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    ProfileStage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(stage) ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(stage)
+
+#else
+
+#define PROFILE_SCOPE(stage)
+
+#endif
+
+// Tabela com n, mdia, p50, p99 e mximo (ms) de cada etapa medida
+void profile_dump(std::ostream& out);
+// Esquece as medies feitas at agora
+void profile_reset();
+
+#endif
@@ -0,0 +1,149 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_THREADS.CPP
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#include "coin_threads.h"
+
+extern "C" {
+#include "vc_simd.h"
+}
+
+ThreadPool::ThreadPool(int nthreads) : generation(0), stop(false) {
+    if (nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+    if (nthreads <= 0) nthreads = 1;
+
+    for (int i = 0; i < nthreads; i++) queues.emplace_back(new Queue());
+
+    // Deteo das instrues vetoriais antes de as threads usarem vc.c
+    vc_simd();
+
+    // A fila 0 recebe as tarefas, mas  esvaziada pelas outras threads e por quem chama parallel_for
+    for (int i = 1; i < nthreads; i++) threads.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& t : threads) t.join();
+}
+
+// Funo de cada thread do pool: espera por tarefas novas e executa-as (da prpria fila e roubadas)
+void ThreadPool::worker(int self) {
+    unsigned long seen = 0;
+    Task task;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+        }
+
+        while (pop(self, task) || steal(self, task)) execute(task);
+    }
+}
+
+void ThreadPool::execute(const Task& task) {
+    (*task.job->task)(task.index);
+
+    // Depois de decrementar pending, job pode j no existir (a chamada retorna)
+    if (task.job->pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+    }
+}
+
+bool ThreadPool::pop(int self, Task& task) {
+    Queue& q = *queues[self];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    if (q.tasks.empty()) return false;
+    task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+}
+
+// Rouba do fim da fila das outras threads (as tarefas mais longe das que o dono est a fazer)
+bool ThreadPool::steal(int self, Task& task) {
+    int n = size();
+
+    for (int i = 1; i < n; i++) {
+        Queue& q = *queues[(self + i) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        if (q.tasks.empty()) continue;
+        task = q.tasks.back();
+        q.tasks.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+// Tarefa de uma chamada em particular, em qualquer fila (para quem espera por essa chamada)
+bool ThreadPool::take(const Job* job, Task& task) {
+    for (auto& queue : queues) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        for (auto it = queue->tasks.rbegin(); it != queue->tasks.rend(); ++it) {
+            if (it->job != job) continue;
+            task = *it;
+            queue->tasks.erase(std::next(it).base());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::parallel_for(int n, const std::function<void(int)>& task) {
+    if (n <= 0) return;
+
+    // Sem threads auxiliares (ou uma s tarefa) no vale a pena passar pelas filas
+    if (threads.empty() || n == 1) {
+        for (int i = 0; i < n; i++) task(i);
+        return;
+    }
+
+    Job job;
+    int nq = size();
+
+    job.task = &task;
+    job.pending.store(n);
+
+    // Blocos contguos de tarefas por fila: tarefas vizinhas (faixas vizinhas) ficam na mesma thread
+    for (int q = 0; q < nq; q++) {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (int i = (int)((long)n * q / nq); i < (int)((long)n * (q + 1) / nq); i++) queues[q]->tasks.push_back({ &job, i });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    // Quem chama s ajuda nas suas tarefas: nunca fica preso numa tarefa longa de outra chamada
+    Task mine;
+    while (job.pending.load() > 0 && take(&job, mine)) execute(mine);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return job.pending.load() == 0; });
+}
+
+void ThreadPool::vc_parallel(void* pool, int n, VCTASK task, void* arg) {
+    ThreadPool* self = (ThreadPool*)pool;
+
+    self->parallel_for(n, [task, arg](int i) { task(arg, i); });
+}
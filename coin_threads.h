@@ -0,0 +1,79 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					FICHEIRO - COIN_THREADS.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef COIN_THREADS_H
+#define COIN_THREADS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "vc.h"
+}
+
+// Conjunto de threads para dividir um frame em faixas
+// Cada thread tem a sua fila de tarefas; quando a esvazia, rouba tarefas do fim das filas das outras.
+// A thread que chama parallel_for tambm trabalha (s nas tarefas dessa chamada), por isso um pool de
+// N threads cria N - 1 threads. Vrias threads (por exemplo, um detector por vdeo) podem chamar
+// parallel_for ao mesmo tempo sobre o mesmo pool.
+class ThreadPool {
+public:
+    explicit ThreadPool(int nthreads);   // 0 = nmero de ncleos
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)queues.size(); }
+
+    // Executa task(0 .. n - 1) e s retorna depois de todas terminarem
+    void parallel_for(int n, const std::function<void(int)>& task);
+
+    // Adaptador para as funes de vc.c que recebem um VCPARALLEL (pool = ThreadPool*)
+    static void vc_parallel(void* pool, int n, VCTASK task, void* arg);
+
+private:
+    // Uma chamada a parallel_for: as suas tarefas andam pelas filas e pending conta as que faltam
+    struct Job {
+        const std::function<void(int)>* task;
+        std::atomic<int> pending;
+    };
+
+    struct Task {
+        Job* job;
+        int index;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker(int self);
+    bool pop(int self, Task& task);
+    bool steal(int self, Task& task);
+    bool take(const Job* job, Task& task);
+    void execute(const Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;                     // Protege generation e stop
+    std::condition_variable wake;         // H tarefas novas (generation mudou) ou o pool vai terminar
+    std::condition_variable finished;     // Uma chamada ficou sem tarefas pendentes
+    unsigned long generation;
+    bool stop;
+};
+
+#endif
@@ -13,17 +13,14 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <limits>
 
 // Definio das constantes globais
 const int FRAME_THRESHOLD = 30;
 const int MAX_DISTANCE = 60;
-const int STABILITY_THRESHOLD = 5;
 const float MAX_AREA_VARIATION = 0.05f;
 const float MIN_CIRCULARITY = 0.11f;
-
-// Definio das variveis globais
-std::vector<CoinTrack> trackedCoins;
-std::map<std::string, int> coinCount;
+const int MIN_COIN_AREA = 7000;
 
 // Funo para calcular o raio do circulo(moeda) baseado na area
 float calculate_radius(int area) {
@@ -36,30 +33,103 @@ float calculate_circularity(int area, int perimeter) {
     return (4.0f * 3.14 * area) / (perimeter * perimeter);
 }
 
-// Funo para classificar moedas baseado na rea, circularidade e cor
-const char* classify_coin(int area, float circularity, const std::string& color) {
+// Funo para converter uma cor mdia (BGR) para HSV, com as escalas e os arredondamentos de
+// cv::cvtColor(COLOR_BGR2HSV) para 8 bits: H 0-180, S e V 0-255
+void bgr_to_hsv(const float bgr[3], int& hue, int& sat, int& val) {
+    int b = (int)std::lround(bgr[0]), g = (int)std::lround(bgr[1]), r = (int)std::lround(bgr[2]);
+    int vmin = std::min(b, std::min(g, r));
+    int diff, h;
+
+    val = std::max(b, std::max(g, r));
+    diff = val - vmin;
+
+    sat = (val == 0) ? 0 : (diff * (int)std::lround((255 << 12) / (double)val) + (1 << 11)) >> 12;
+
+    if (diff == 0) {
+        hue = 0;
+        return;
+    }
+    if (val == r) h = g - b;
+    else if (val == g) h = b - r + 2 * diff;
+    else h = r - g + 4 * diff;
+
+    h = (h * (int)std::lround((180 << 12) / (6.0 * diff)) + (1 << 11)) >> 12;
+    hue = (h < 0) ? h + 180 : h;
+}
+
+// Cores das moedas, testadas por ordem (a primeira que contm o HSV)
+static constexpr ColourRule COLOUR_RULES[] = {
+    { COLOUR_GOLD,   25, 30, 20, 140, 65, 150 },
+    { COLOUR_SILVER, 15, 60, 1, 60, 10, 120 },
+    { COLOUR_COPPER, 10, 60, 80, 215, 40, 120 },
+};
+
+// Denominaes: as regras mais especficas primeiro (as bimetlicas, com o anel de outra cor).
+// Outra moeda (ou outras reas, para outra cmara)  s mais uma linha na tabela
+static constexpr int NO_AREA_LIMIT = std::numeric_limits<int>::max();
+static constexpr double NO_CIRCULARITY_LIMIT = std::numeric_limits<double>::max();
+static constexpr CoinRule COIN_RULES[] = {
+    // Moedas bimetlicas: centro e anel de cores diferentes
+    { COIN_1_EURO,  10000, 22000, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_SILVER, COLOUR_GOLD },
+    { COIN_2_EURO,  22300, NO_AREA_LIMIT, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_GOLD, COLOUR_SILVER },
+
     // Moedas pequenas, de cobre
-    if (area >= 8000 && area < 11000 && color == "cooper") return "1 centimo";
-    else if (area >= 13000 && area < 15000 && circularity > 0.9) return "2 centimos";
-    else if (area >= 17000 && area < 18500 && circularity > 0.7) return "5 centimos";
+    { COIN_1_CENT,  8000, 11000, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_COPPER, COLOUR_ANY },
+    { COIN_2_CENT,  13000, 15000, 0.9, NO_CIRCULARITY_LIMIT, COLOUR_ANY, COLOUR_ANY },
+    { COIN_5_CENT,  17000, 18500, 0.7, NO_CIRCULARITY_LIMIT, COLOUR_ANY, COLOUR_ANY },
 
     // Moedas douradas
-    else if (area > 10000 && area <= 16800 && color == "gold") return "10 centimos";
-    else if (area >= 19000 && area < 22000 && color == "gold") {
-        return "20 centimos";
-    }
+    { COIN_10_CENT, 10001, 16801, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_GOLD, COLOUR_ANY },
+    { COIN_20_CENT, 19000, 22000, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_GOLD, COLOUR_ANY },
+
     // Moedas com combinao de cor e forma
-    else if (area >= 10000 && area < 22000 && (color == "silver" || circularity < 0.5)) {
-        return "1 euro";
-    }
-    else if (area >= 22300 && area <= 25000) {
-        return "50 centimos";
+    { COIN_1_EURO,  10000, 22000, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_SILVER, COLOUR_ANY },
+    { COIN_1_EURO,  10000, 22000, -1.0, 0.5, COLOUR_ANY, COLOUR_ANY },
+    { COIN_50_CENT, 22300, 25001, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_ANY, COLOUR_ANY },
+    { COIN_2_EURO,  25000, NO_AREA_LIMIT, -1.0, NO_CIRCULARITY_LIMIT, COLOUR_GOLD, COLOUR_ANY },
+};
+
+// Regras bem formadas (verificado ao compilar)
+static constexpr bool valid_rules(int i) {
+    return i == (int)(sizeof(COIN_RULES) / sizeof(COIN_RULES[0])) ||
+        (COIN_RULES[i].type < N_COIN_TYPES && COIN_RULES[i].minArea < COIN_RULES[i].maxArea &&
+            COIN_RULES[i].minCircularity < COIN_RULES[i].maxCircularity && valid_rules(i + 1));
+}
+static_assert(valid_rules(0), "COIN_RULES: regra com intervalo vazio ou tipo invlido");
+
+static const char* const COIN_NAMES[N_COIN_TYPES + 1] = { "1 centimo", "2 centimos", "5 centimos", "10 centimos",
+    "20 centimos", "50 centimos", "1 euro", "2 euros", "A Carregar..." };
+static const char* const COLOUR_NAMES[] = { "indefinido", "gold", "silver", "cooper", "qualquer" };
+
+const char* coin_name(CoinType type) {
+    return COIN_NAMES[type];
+}
+
+const char* colour_name(CoinColour colour) {
+    return COLOUR_NAMES[colour];
+}
+
+// Funo para classificar a cor de uma zona da moeda (centro ou anel) a partir do HSV
+CoinColour classify_colour(int hue, int sat, int val) {
+    for (const ColourRule& rule : COLOUR_RULES) {
+        if (hue >= rule.hmin && hue <= rule.hmax && sat >= rule.smin && sat <= rule.smax &&
+            val >= rule.vmin && val <= rule.vmax) return rule.colour;
     }
-    else if (area >= 25000 && color == "gold") {
-        return "2 euros";
+
+    return COLOUR_UNDEFINED;
+}
+
+// Funo para classificar moedas baseado na rea, circularidade e cor (do centro e do anel exterior)
+CoinType classify_coin(int area, float circularity, CoinColour colour, CoinColour ringColour) {
+    for (const CoinRule& rule : COIN_RULES) {
+        if (area < rule.minArea || area >= rule.maxArea) continue;
+        if (circularity <= rule.minCircularity || circularity >= rule.maxCircularity) continue;
+        if (rule.colour != COLOUR_ANY && colour != rule.colour) continue;
+        if (rule.ringColour != COLOUR_ANY && ringColour != rule.ringColour) continue;
+        return rule.type;
     }
 
-    return "A Carregar...";
+    return COIN_UNKNOWN;
 }
 
 // Funo para calcular a distancia entre os centros de dois retanguloss
@@ -71,81 +141,217 @@ double calculateDistance(const cv::Rect& r1, const cv::Rect& r2) {
 }
 
 // Funo para verificar se uma nova detecao corresponde a uma moeda j rastreada
-int findMatchingCoin(const cv::Rect& newBBox, int currentFrame) {
-    for (size_t i = 0; i < trackedCoins.size(); i++) {
+// Devolve a moeda mais prxima (em empate, a mais antiga) dentro de MAX_DISTANCE, procurando s nas clulas vizinhas
+int findMatchingCoin(const std::vector<CoinTrack>& trackedCoins, const TrackGrid& grid, const cv::Rect& newBBox, int currentFrame) {
+    int best = -1;
+    double bestDistance = MAX_DISTANCE;
+
+    grid.near(newBBox, [&](int i) {
         double distance = calculateDistance(newBBox, trackedCoins[i].bbox);
 
         // Se a distncia for menor que o limite, consideramos a mesma moeda
-        if (distance < MAX_DISTANCE) {
-            return i;  // Retorna o ndice da moeda rastreada
+        if (distance < bestDistance || (distance == bestDistance && best >= 0 && i < best)) {
+            best = i;
+            bestDistance = distance;
         }
-    }
+    });
 
-    return -1;  // Nenhuma correspondncia encontrada
+    return best;  // ndice da moeda rastreada, ou -1 se nenhuma corresponder
 }
 
-//Funo para desenhar centro de massa da moeda
-void drawCenter(cv::Mat& frame, cv::Point center, int radius, cv::Vec3b color) {
-    int rows = frame.rows;
-    int cols = frame.cols;
+// Atribuio tima (Hungarian) de um grupo pequeno: linhas = blobs, colunas = moedas + um "sem
+// correspondncia" por blob; cost  n x m (n <= m), por linhas. Devolve em row a coluna de cada linha
+static void hungarian(const std::vector<double>& cost, int n, int m, std::vector<int>& row) {
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> u(n + 1, 0), v(m + 1, 0), minv(m + 1);
+    std::vector<int> p(m + 1, 0), way(m + 1, 0);
+    std::vector<char> used(m + 1);
 
-    int x_start = std::max(center.x - radius, 0);
-    int x_end = std::min(center.x + radius, cols - 1);
-    int y_start = std::max(center.y - radius, 0);
-    int y_end = std::min(center.y + radius, rows - 1);
+    for (int i = 1; i <= n; i++) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv.begin(), minv.end(), INF);
+        std::fill(used.begin(), used.end(), 0);
 
-    for (int y = y_start; y <= y_end; y++) {
-        for (int x = x_start; x <= x_end; x++) {
-            frame.at<cv::Vec3b>(y, x) = color;
-        }
+        do {
+            used[j0] = 1;
+            int i0 = p[j0], j1 = 0;
+            double delta = INF;
+
+            for (int j = 1; j <= m; j++) {
+                if (used[j]) continue;
+                double cur = cost[(i0 - 1) * m + (j - 1)] - u[i0] - v[j];
+                if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for (int j = 0; j <= m; j++) {
+                if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
     }
+
+    row.assign(n, -1);
+    for (int j = 1; j <= m; j++) if (p[j] != 0) row[p[j] - 1] = j - 1;
 }
 
-//Funo para desenhar bouding box da moeda
-void drawRectangleManual(cv::Mat& frame, cv::Rect rect, cv::Vec3b color) {
-    int rows = frame.rows;
-    int cols = frame.cols;
-    int thickness = 3;
+static int assign_find(std::vector<int>& parent, int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
 
-    for (int t = 0; t < thickness; t++) {
-        // Linha superior horizontal
-        int y = rect.y + t;
-        if (y >= 0 && y < rows) {
-            for (int x = rect.x; x < rect.x + rect.width; x++) {
-                if (x >= 0 && x < cols)
-                    frame.at<cv::Vec3b>(y, x) = color;
-            }
-        }   
-
-        // Linha inferior horizontal
-        y = rect.y + rect.height - 1 - t;
-        if (y >= 0 && y < rows) {
-            for (int x = rect.x; x < rect.x + rect.width; x++) {
-                if (x >= 0 && x < cols)
-                    frame.at<cv::Vec3b>(y, x) = color;
-            }
+// Funo para corresponder todos os blobs do frame de uma vez: cada moeda seguida fica com no mximo
+// um blob e a soma das distncias  mnima (no ter correspondncia custa MAX_DISTANCE).
+// S h arestas entre blobs e moedas a menos de MAX_DISTANCE (clulas vizinhas da grelha), e o
+// problema separa-se em grupos ligados por essas arestas, resolvidos um a um; com as moedas
+// afastadas umas das outras os grupos so de 1 ou 2 e o custo  dominado pela ordenao das arestas.
+// matches[i] = ndice em trackedCoins do blob newBBoxes[i], ou -1 (moeda nova)
+void assignCoins(const std::vector<CoinTrack>& trackedCoins, const TrackGrid& grid, const std::vector<cv::Rect>& newBBoxes, std::vector<int>& matches) {
+    struct Edge { int blob, track; double distance; int group; };
+    int nblobs = (int)newBBoxes.size();
+    std::vector<Edge> edges;
+
+    matches.assign(nblobs, -1);
+
+    for (int i = 0; i < nblobs; i++) {
+        grid.near(newBBoxes[i], [&](int j) {
+            double distance = calculateDistance(newBBoxes[i], trackedCoins[j].bbox);
+            if (distance < MAX_DISTANCE) edges.push_back({ i, j, distance, 0 });
+        });
+    }
+    if (edges.empty()) return;
+
+    // Grupos ligados: ns 0..nblobs-1 so blobs, nblobs + j  a moeda j
+    std::vector<int> parent(nblobs + trackedCoins.size());
+    for (size_t k = 0; k < parent.size(); k++) parent[k] = (int)k;
+    for (const Edge& e : edges) {
+        int a = assign_find(parent, e.blob), b = assign_find(parent, nblobs + e.track);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    // Arestas ordenadas por grupo (a raiz do blob) e, dentro do grupo, por blob
+    for (Edge& e : edges) e.group = assign_find(parent, e.blob);
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        if (a.group != b.group) return a.group < b.group;
+        if (a.blob != b.blob) return a.blob < b.blob;
+        return a.track < b.track;
+    });
+
+    std::vector<int> blobs, tracks, row;
+    std::vector<double> cost;
+
+    for (size_t first = 0, last; first < edges.size(); first = last) {
+        for (last = first; last < edges.size() && edges[last].group == edges[first].group; last++);
+
+        // Caso comum: um blob e uma moeda
+        if (last - first == 1) {
+            matches[edges[first].blob] = edges[first].track;
+            continue;
         }
 
-        // Linha vertical esquerda
-        int x = rect.x + t;
-        if (x >= 0 && x < cols) {
-            for (int y = rect.y; y < rect.y + rect.height; y++) {
-                if (y >= 0 && y < rows)
-                    frame.at<cv::Vec3b>(y, x) = color;
-            }
+        blobs.clear();
+        tracks.clear();
+        for (size_t k = first; k < last; k++) {
+            if (blobs.empty() || blobs.back() != edges[k].blob) blobs.push_back(edges[k].blob);
+            tracks.push_back(edges[k].track);
         }
+        std::sort(tracks.begin(), tracks.end());
+        tracks.erase(std::unique(tracks.begin(), tracks.end()), tracks.end());
 
-        // Linha vertical direita
-        x = rect.x + rect.width - 1 - t;
-        if (x >= 0 && x < cols) {
-            for (int y = rect.y; y < rect.y + rect.height; y++) {
-                if (y >= 0 && y < rows)
-                    frame.at<cv::Vec3b>(y, x) = color;
-            }
+        int n = (int)blobs.size(), m = (int)tracks.size() + n;
+
+        // Sem aresta: custo maior do que ficar sem correspondncia, nunca  escolhido
+        cost.assign((size_t)n * m, 2.0 * MAX_DISTANCE);
+        for (int i = 0; i < n; i++)
+            for (int j = (int)tracks.size(); j < m; j++) cost[(size_t)i * m + j] = MAX_DISTANCE;
+        for (size_t k = first; k < last; k++) {
+            int i = (int)(std::lower_bound(blobs.begin(), blobs.end(), edges[k].blob) - blobs.begin());
+            int j = (int)(std::lower_bound(tracks.begin(), tracks.end(), edges[k].track) - tracks.begin());
+            cost[(size_t)i * m + j] = edges[k].distance;
+        }
+
+        hungarian(cost, n, m, row);
+        for (int i = 0; i < n; i++) {
+            if (row[i] < (int)tracks.size()) matches[blobs[i]] = tracks[row[i]];
         }
     }
 }
 
+void TrackGrid::cell_of(const cv::Rect& bbox, int& cx, int& cy) const {
+    // Mesmo centro (inteiro) que calculateDistance
+    cx = std::min(std::max((bbox.x + bbox.width / 2) / MAX_DISTANCE, 0), cols - 1);
+    cy = std::min(std::max((bbox.y + bbox.height / 2) / MAX_DISTANCE, 0), rows - 1);
+}
+
+void TrackGrid::resize(int width, int height, const std::vector<CoinTrack>& trackedCoins) {
+    int c = width / MAX_DISTANCE + 1;
+    int r = height / MAX_DISTANCE + 1;
+
+    if (c == cols && r == rows) return;
+    cols = c;
+    rows = r;
+    cells.assign((size_t)cols * rows, std::vector<int>());
+    rebuild(trackedCoins);
+}
+
+void TrackGrid::rebuild(const std::vector<CoinTrack>& trackedCoins) {
+    clear();
+    for (size_t i = 0; i < trackedCoins.size(); i++) insert((int)i, trackedCoins[i].bbox);
+}
+
+void TrackGrid::clear() {
+    for (std::vector<int>& cell : cells) cell.clear();   // Mantm a memria das clulas
+}
+
+void TrackGrid::insert(int index, const cv::Rect& bbox) {
+    if (cells.empty()) return;
+
+    int cx, cy;
+    cell_of(bbox, cx, cy);
+    cells[cy * cols + cx].push_back(index);
+}
+
+void TrackGrid::move(int index, const cv::Rect& oldBBox, const cv::Rect& newBBox) {
+    if (cells.empty()) return;
+
+    int ox, oy, nx, ny;
+    cell_of(oldBBox, ox, oy);
+    cell_of(newBBox, nx, ny);
+    if (ox == nx && oy == ny) return;
+
+    std::vector<int>& from = cells[oy * cols + ox];
+    from.erase(std::find(from.begin(), from.end(), index));
+    cells[ny * cols + nx].push_back(index);
+}
+
+// Funo para atualizar a velocidade (modelo de velocidade constante) com uma nova correspondncia,
+// antes de bbox e lastSeenFrame mudarem
+void updateVelocity(CoinTrack& coin, const cv::Rect& newBBox, int currentFrame) {
+    int frames = currentFrame - coin.lastSeenFrame;
+    if (frames <= 0) return;
+
+    float dx = (float)((newBBox.x + newBBox.width / 2) - (coin.bbox.x + coin.bbox.width / 2)) / frames;
+    float dy = (float)((newBBox.y + newBBox.height / 2) - (coin.bbox.y + coin.bbox.height / 2)) / frames;
+
+    // Primeira correspondncia: velocidade medida; depois, mdia com a anterior (menos rudo)
+    if (currentFrame - coin.firstSeenFrame == frames) coin.velocity = cv::Point2f(dx, dy);
+    else coin.velocity = cv::Point2f(0.5f * (coin.velocity.x + dx), 0.5f * (coin.velocity.y + dy));
+}
+
+// Funo para prever a caixa da moeda num frame, com a velocidade desde a ltima vez que foi vista
+cv::Rect predictBBox(const CoinTrack& coin, int frame) {
+    float frames = (float)(frame - coin.lastSeenFrame);
+
+    return cv::Rect(coin.bbox.x + (int)std::lround(coin.velocity.x * frames),
+        coin.bbox.y + (int)std::lround(coin.velocity.y * frames), coin.bbox.width, coin.bbox.height);
+}
 
 // Funo para medir o tempo de execuo
 void vc_timer(void) {
@@ -11,12 +11,106 @@
 #define COIN_UTILS_H
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
 #include <string>
+#include <vector>
+
+// Denominaes das moedas (ndices em CoinCounts), por ordem de valor
+enum CoinType {
+    COIN_1_CENT, COIN_2_CENT, COIN_5_CENT, COIN_10_CENT, COIN_20_CENT, COIN_50_CENT, COIN_1_EURO, COIN_2_EURO,
+    N_COIN_TYPES,
+    COIN_UNKNOWN = N_COIN_TYPES   // Ainda sem tipo ("A Carregar...")
+};
+
+// Cores de uma zona da moeda (centro ou anel)
+enum CoinColour { COLOUR_UNDEFINED, COLOUR_GOLD, COLOUR_SILVER, COLOUR_COPPER, COLOUR_ANY };
+
+// Moedas contadas por denominao; a ltima posio (COIN_UNKNOWN) conta as moedas confirmadas
+// sem nenhuma regra que lhes d tipo
+typedef std::array<int, N_COIN_TYPES + 1> CoinCounts;
+static_assert(std::tuple_size<CoinCounts>::value > COIN_UNKNOWN, "CoinCounts: sem posio para COIN_UNKNOWN");
+
+// Regra de classificao: a primeira regra (pela ordem da tabela) que aceita a moeda d o tipo.
+// rea em [minArea, maxArea); circularidade em ]minCircularity, maxCircularity[
+struct CoinRule {
+    CoinType type;
+    int minArea, maxArea;
+    double minCircularity, maxCircularity;
+    CoinColour colour;        // Cor do centro (COLOUR_ANY: qualquer)
+    CoinColour ringColour;    // Cor do anel exterior (COLOUR_ANY: qualquer)
+};
+
+// Intervalo HSV de uma cor (H 0-180, S e V 0-255, inclusive), como devolvido por bgr_to_hsv
+struct ColourRule {
+    CoinColour colour;
+    int hmin, hmax, smin, smax, vmin, vmax;
+};
+
+// Frames seguidos com rea estvel para confirmar o tipo (tamanho do histrico de cada moeda)
+const int STABILITY_THRESHOLD = 5;
+
+// Histrico dos ltimos N valores num array fixo (buffer circular), sem alocaes: a soma, o mnimo
+// e o mximo so atualizados a cada valor novo, por isso a mdia e a variao custam O(1)
+template <int N>
+class RingHistory {
+public:
+    RingHistory() : total(0), lo(0), hi(0), start(0), count(0) {}
+
+    void push(int value) {
+        int evicted = 0;
+        bool full = count == N;
+
+        if (full) {
+            evicted = values[start];
+            total -= evicted;
+            values[start] = value;
+            start = (unsigned char)((start + 1) % N);
+        }
+        else {
+            values[(start + count) % N] = value;
+            count++;
+        }
+        total += value;
+
+        // S  preciso percorrer o histrico quando sai o mnimo ou o mximo
+        if (count == 1) lo = hi = value;
+        else if (full && (evicted == lo || evicted == hi)) rescan();
+        else {
+            if (value < lo) lo = value;
+            if (value > hi) hi = value;
+        }
+    }
+
+    void clear() { total = 0; lo = hi = 0; start = 0; count = 0; }
+
+    int size() const { return count; }
+    bool full() const { return count == N; }
+    int sum() const { return total; }
+    int mean() const { return count > 0 ? total / count : 0; }
+    int min() const { return lo; }
+    int max() const { return hi; }
+    int operator[](int i) const { return values[(start + i) % N]; }   // 0 = o mais antigo
+
+private:
+    void rescan() {
+        lo = hi = values[0];
+        for (int i = 1; i < count; i++) {
+            if (values[i] < lo) lo = values[i];
+            if (values[i] > hi) hi = values[i];
+        }
+    }
+
+    int values[N];
+    int total, lo, hi;
+    unsigned char start, count;
+};
 
 // Estrutura para rastrear moedas
 struct CoinTrack {
     cv::Rect bbox;            // Bounding box da moeda
-    std::string type;         // Tipo da moeda (1 cntimo, 2 cntimos, ...)
+    int id;                   // Identificador da moeda no vdeo (para os registos)
+    CoinType type;            // Tipo da moeda (1 cntimo, 2 cntimos, ...)
 
     int lastSeenFrame;        // ltimo frame em que a moeda foi vista
     int firstSeenFrame;       // Primeiro frame em que a moeda foi vista
@@ -26,36 +120,68 @@ struct CoinTrack {
     int finalPerimeter;       // Permetro final confirmado para a moeda
     float finalCircularity;   // Circularidade final confirmada para a moeda
 
-    cv::Point fixedCenter;
-    std::vector<int> areaHistory;      // Histrico das ltimas reas detectadas
-    std::vector<int> perimeterHistory; // Histrico dos ltimos permetros detectados
+    RingHistory<STABILITY_THRESHOLD> areaHistory;      // Histrico das ltimas reas detectadas
+    RingHistory<STABILITY_THRESHOLD> perimeterHistory; // Histrico dos ltimos permetros detectados
     bool matched_this_frame;           // Flag para indicar se foi correspondida neste frame
+    cv::Point2f velocity;              // Deslocamento do centro por frame (mdia das ltimas correspondncias)
 
     // Construtor para inicializar
-    CoinTrack() : counted(false), typeConfirmed(false), finalArea(0), finalPerimeter(0),
-        finalCircularity(0.0f), matched_this_frame(false) {
+    CoinTrack() : id(-1), type(COIN_UNKNOWN), counted(false), typeConfirmed(false), finalArea(0), finalPerimeter(0),
+        finalCircularity(0.0f), matched_this_frame(false), velocity(0.0f, 0.0f) {
+    }
+};
+
+// ndice espacial dos centros das moedas seguidas: grelha uniforme com clulas de MAX_DISTANCE,
+// de modo que qualquer correspondncia (distncia < MAX_DISTANCE) est na clula do centro
+// ou numa das 8 vizinhas. As clulas guardam ndices em trackedCoins.
+class TrackGrid {
+public:
+    TrackGrid() : cols(0), rows(0) {}
+
+    // Dimenses do frame; se mudarem, a grelha  refeita a partir das moedas
+    void resize(int width, int height, const std::vector<CoinTrack>& trackedCoins);
+
+    void rebuild(const std::vector<CoinTrack>& trackedCoins);   // Depois de remover moedas (os ndices mudam)
+    void insert(int index, const cv::Rect& bbox);
+    void move(int index, const cv::Rect& oldBBox, const cv::Rect& newBBox);
+    void clear();
+
+    // ndices das moedas nas clulas  volta de bbox (candidatas a corresponder)
+    template <typename F> void near(const cv::Rect& bbox, F visit) const {
+        int cx, cy;
+        cell_of(bbox, cx, cy);
+        for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, rows - 1); y++)
+            for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cols - 1); x++)
+                for (int index : cells[y * cols + x]) visit(index);
     }
+
+private:
+    void cell_of(const cv::Rect& bbox, int& cx, int& cy) const;
+
+    int cols, rows;
+    std::vector<std::vector<int>> cells;
 };
 
 // Funes auxiliares
 float calculate_radius(int area);
 float calculate_circularity(int area, int perimeter);
-const char* classify_coin(int area, float circularity, const std::string& color);
+CoinType classify_coin(int area, float circularity, CoinColour colour, CoinColour ringColour);
+void bgr_to_hsv(const float bgr[3], int& hue, int& sat, int& val);
+CoinColour classify_colour(int hue, int sat, int val);
+const char* coin_name(CoinType type);
+const char* colour_name(CoinColour colour);
 double calculateDistance(const cv::Rect& r1, const cv::Rect& r2);
-int findMatchingCoin(const cv::Rect& newBBox, int currentFrame);
-void drawCenter(cv::Mat& frame, cv::Point center, int radius, cv::Vec3b color);
-void drawRectangleManual(cv::Mat& frame, cv::Rect rect, cv::Vec3b color);
+int findMatchingCoin(const std::vector<CoinTrack>& trackedCoins, const TrackGrid& grid, const cv::Rect& newBBox, int currentFrame);
+void assignCoins(const std::vector<CoinTrack>& trackedCoins, const TrackGrid& grid, const std::vector<cv::Rect>& newBBoxes, std::vector<int>& matches);
+void updateVelocity(CoinTrack& coin, const cv::Rect& newBBox, int currentFrame);
+cv::Rect predictBBox(const CoinTrack& coin, int frame);
 void vc_timer(void);
 
 // Constantes globais
 extern const int FRAME_THRESHOLD;
 extern const int MAX_DISTANCE;
-extern const int STABILITY_THRESHOLD;
 extern const float MAX_AREA_VARIATION;
 extern const float MIN_CIRCULARITY;
-
-// Variveis globais
-extern std::vector<CoinTrack> trackedCoins;
-extern std::map<std::string, int> coinCount;
+extern const int MIN_COIN_AREA;
 
 #endif
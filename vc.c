@@ -13,8 +13,21 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdlib.h>
 #include <malloc.h>
 #include "vc.h"
+#include "vc_simd.h"
+
+// Sem contração de multiplicações e somas em FMA (GCC com -march=native/-mfma, Clang, MSVC com
+// /fp:contract): o código escalar e os kernels vetoriais arredondam cada produto antes de somar,
+// para darem exatamente o mesmo resultado em qualquer compilador e CPU
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
 
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -65,6 +78,53 @@ IVC *vc_image_free(IVC *image)
 }
 
 
+// Preencher uma vista (sem cópia) sobre dados de outra imagem
+// A vista não é dona dos dados: não deve ser libertada com vc_image_free()
+int vc_image_view(IVC *view, unsigned char *data, int width, int height, int channels, int bytesperline)
+{
+	if((view == NULL) || (data == NULL)) return 0;
+	if((width <= 0) || (height <= 0) || (channels <= 0)) return 0;
+	if(bytesperline < width * channels) return 0;
+
+	view->data = data;
+	view->width = width;
+	view->height = height;
+	view->channels = channels;
+	view->levels = 255;
+	view->bytesperline = bytesperline;
+
+	return 1;
+}
+
+
+// Reduzir uma imagem factor vezes em cada eixo, ficando com o pixel (x * factor, y * factor)
+// Sem médias: os pixels de dst são pixels de src (a mesma segmentação dá a máscara reduzida)
+// dst: (src->width / factor) x (src->height / factor), com os mesmos canais
+int vc_image_subsample(IVC *src, IVC *dst, int factor)
+{
+	int x, y, c;
+	int channels = src->channels;
+	unsigned char *pSrc, *pDst;
+
+	if((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL)) return 0;
+	if(factor < 1) return 0;
+	if((dst->width != src->width / factor) || (dst->height != src->height / factor) || (dst->channels != channels)) return 0;
+
+	for(y = 0; y < dst->height; y++)
+	{
+		pSrc = &src->data[(long int)y * factor * src->bytesperline];
+		pDst = &dst->data[(long int)y * dst->bytesperline];
+
+		for(x = 0; x < dst->width; x++, pSrc += factor * channels, pDst += channels)
+		{
+			for(c = 0; c < channels; c++) pDst[c] = pSrc[c];
+		}
+	}
+
+	return 1;
+}
+
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //    FUNÇÕES: LEITURA E ESCRITA DE IMAGENS (PBM, PGM E PPM)
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -371,6 +431,7 @@ int vc_gray_negative(IVC* srcdst)
 	int height = srcdst->height;
 	int bytesperline = srcdst->bytesperline;
 	int channels = srcdst->channels;
+	const VCSIMD* simd = vc_simd();
 	int x, y;
 	long int pos;
 
@@ -378,10 +439,12 @@ int vc_gray_negative(IVC* srcdst)
 	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL)) return 0;
 	if (channels != 1) return 0;
 
-	// Inverte a imagem Gray
+	// Inverte a imagem Gray (o início de cada linha pode ser feito pelo kernel vetorial)
 	for (y = 0;y < height;y++) 
 	{
-		for (x = 0;x < width;x++)
+		x = (simd->gray_negative != NULL) ? simd->gray_negative(&data[y * bytesperline], width) : 0;
+
+		for (;x < width;x++)
 		{
 			pos = y * bytesperline + x * channels;
 			data[pos] = 255 - data[pos];
@@ -422,16 +485,18 @@ int vc_rgb_negative(IVC* srcdst)
 }
 
 // Converter de RGB para Gray
-int vc_rgb_to_gray(IVC* src, IVC* dst)
+// ir, ib: posição (0 ou 2) dos canais R e B em cada pixel, para suportar RGB e BGR
+static int vc_rgb_to_gray_order(IVC* src, IVC* dst, int ir, int ib)
 {
 	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
+	int bytesperline_src = src->bytesperline;
 	int channels_src = src->channels;
 	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
+	int bytesperline_dst = dst->bytesperline;
 	int channels_dst = dst->channels;
 	int width = src->width;
 	int height = src->height;
+	const VCSIMD* simd = vc_simd();
 	int x, y;
 	long int pos_src, pos_dst;
 	float rf, gf, bf;
@@ -443,14 +508,16 @@ int vc_rgb_to_gray(IVC* src, IVC* dst)
 
 	for (y = 0; y < height; y++)
 	{
-		for (x = 0; x < width; x++)
+		x = (simd->rgb_to_gray != NULL) ? simd->rgb_to_gray(&datasrc[y * bytesperline_src], &datadst[y * bytesperline_dst], width, ir, ib) : 0;
+
+		for (; x < width; x++)
 		{
 			pos_src = y * bytesperline_src + x * channels_src;
 			pos_dst = y * bytesperline_dst + x * channels_dst;
 
-			rf = (float)datasrc[pos_src];
+			rf = (float)datasrc[pos_src + ir];
 			gf = (float)datasrc[pos_src + 1];
-			bf = (float)datasrc[pos_src + 2];
+			bf = (float)datasrc[pos_src + ib];
 
 			datadst[pos_dst] = (unsigned char)((rf * 0.299) + (gf * 0.587) + (bf * 0.114));
 		}
@@ -459,19 +526,78 @@ int vc_rgb_to_gray(IVC* src, IVC* dst)
 	return 1;
 }
 
-int vc_rgb_to_hsv(IVC* src, IVC* dst)
+int vc_rgb_to_gray(IVC* src, IVC* dst)
+{
+	return vc_rgb_to_gray_order(src, dst, 0, 2);
+}
+
+// Igual a vc_rgb_to_gray, mas lê os pixels pela ordem BGR do OpenCV
+int vc_bgr_to_gray(IVC* src, IVC* dst)
+{
+	return vc_rgb_to_gray_order(src, dst, 2, 0);
+}
+
+// Converter um pixel RGB para HSV (H, S e V em [0, 255])
+// Partilhado pela conversão de imagens e pela segmentação fundida, para darem o mesmo resultado
+static void vc_pixel_rgb_to_hsv(unsigned char r, unsigned char g, unsigned char b, unsigned char* hsv)
+{
+	float rf, gf, bf, max, min, hue, sat;
+
+	rf = (float)r;
+	gf = (float)g;
+	bf = (float)b;
+
+	max = MAX3(rf, gf, bf);
+	min = MIN3(rf, gf, bf);
+
+	hue = 0;
+	sat = 0;
+
+	if ((max != min) && (max != 0))
+	{
+		sat = (max - min) / max * 255.0f;
+
+		if (max == rf)
+		{
+			if (gf >= bf)
+			{
+				hue = 60.0f * ((gf - bf) / (max - min));
+			}
+			else
+			{
+				hue = 360.0f + 60.0f * ((gf - bf) / (max - min));
+			}
+		}
+		else if (max == gf)
+		{
+			hue = 120.0f + 60.0f * ((bf - rf) / (max - min));
+		}
+		else if (max == bf)
+		{
+			hue = 240.0f + 60.0f * ((rf - gf) / (max - min));
+		}
+	}
+
+	hsv[0] = (unsigned char)((hue / 360.0f) * 255.0f);
+	hsv[1] = (unsigned char)sat;
+	hsv[2] = (unsigned char)max;
+}
+
+// Converter de RGB para HSV (H, S e V em [0, 255])
+// ir, ib: posição (0 ou 2) dos canais R e B em cada pixel, para suportar RGB e BGR
+static int vc_rgb_to_hsv_order(IVC* src, IVC* dst, int ir, int ib)
 {
 	unsigned char* datasrc = (unsigned char*)src->data;
 	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_src = src->width * src->channels;
-	int bytesperline_dst = dst->width * dst->channels;
+	int bytesperline_src = src->bytesperline;
+	int bytesperline_dst = dst->bytesperline;
 	int channels_src = src->channels;
 	int channels_dst = dst->channels;
 	int width = src->width;
 	int height = src->height;
+	const VCSIMD* simd = vc_simd();
 	int x, y;
 	long int pos_src, pos_dst;
-	float rf, gf, bf, max, min, hue, sat;
 
 	// Verificação de erros
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
@@ -480,68 +606,45 @@ int vc_rgb_to_hsv(IVC* src, IVC* dst)
 
 	for (y = 0; y < height; y++)
 	{
-		for (x = 0; x < width; x++)
+		x = (simd->rgb_to_hsv != NULL) ? simd->rgb_to_hsv(&datasrc[y * bytesperline_src], &datadst[y * bytesperline_dst], width, ir, ib) : 0;
+
+		for (; x < width; x++)
 		{
 			pos_src = y * bytesperline_src + x * channels_src;
 			pos_dst = y * bytesperline_dst + x * channels_dst;
 
-			rf = (float)datasrc[pos_src];
-			gf = (float)datasrc[pos_src + 1];
-			bf = (float)datasrc[pos_src + 2];
-
-			max = MAX3(rf, gf, bf);
-			min = MIN3(rf, gf, bf);
-
-			if ((max == min) || (max == 0))
-			{
-				hue = 0;
-				sat = 0;
-
-			}
-			else {
-
-				sat = (max - min) / max * 255.0f;
-
-				if (max == rf)
-				{
-					if (gf >= bf)
-					{
-						hue = 60.0f * ((gf - bf) / (max - min));
-					}
-					else
-					{
-						hue = 360.0f + 60.0f * ((gf - bf) / (max - min));
-					}
-				}
-				else if (max == gf)
-				{
-					hue = 120.0f + 60.0f * ((bf - rf) / (max - min));
-				}
-				else if (max == bf)
-				{
-					hue = 240.0f + 60.0f * ((rf - gf) / (max - min));
-				}
-			}
-			datadst[pos_dst] = (unsigned char)((hue / 360.0f) * 255.0f);
-			datadst[pos_dst + 1] = (unsigned char)sat;
-			datadst[pos_dst + 2] = (unsigned char)max;
+			vc_pixel_rgb_to_hsv(datasrc[pos_src + ir], datasrc[pos_src + 1], datasrc[pos_src + ib], &datadst[pos_dst]);
 		}
 	}
 	return 1;
 }
 
+int vc_rgb_to_hsv(IVC* src, IVC* dst)
+{
+	return vc_rgb_to_hsv_order(src, dst, 0, 2);
+}
+
+// Igual a vc_rgb_to_hsv, mas lê os pixels pela ordem BGR do OpenCV (sem conversão prévia)
+int vc_bgr_to_hsv(IVC* src, IVC* dst)
+{
+	return vc_rgb_to_hsv_order(src, dst, 2, 0);
+}
+
 int vc_hsv_segmentation(IVC* src, IVC* dst, int hmin, int hmax, int smin, int smax, int vmin, int vmax)
 {
 	unsigned char* dataSrc = (unsigned char*)src->data;
-	int bytesPerLineSrc = src->width * src->channels;
+	int bytesPerLineSrc = src->bytesperline;
 	int channelsSrc = src->channels;
 	unsigned char* dataDst = (unsigned char*)dst->data;
-	int bytesPerLineDst = dst->width * dst->channels;
+	int bytesPerLineDst = dst->bytesperline;
 	int channelsDst = dst->channels;
 	int width = src->width;
 	int height = src->height;
 	long int posSrc, posDst;
 	float h, s, v;
+	const VCSIMD* simd = vc_simd();
+	int limits[6];
+	int x;
 
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
 	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
@@ -558,9 +661,15 @@ int vc_hsv_segmentation(IVC* src, IVC* dst, int hmin, int hmax, int smin, int sm
 	vmin = ((float)vmin * 255) / 100;
 	vmax = ((float)vmax * 255) / 100;
 
+	limits[0] = hmin; limits[1] = hmax;
+	limits[2] = smin; limits[3] = smax;
+	limits[4] = vmin; limits[5] = vmax;
+
 	for (int y = 0; y < height;  y++)
 	{
-		for (int x = 0; x < width; x++) 
+		x = (simd->hsv_inrange != NULL) ? simd->hsv_inrange(&dataSrc[y * bytesPerLineSrc], &dataDst[y * bytesPerLineDst], width, limits) : 0;
+
+		for (; x < width; x++) 
 		{
 			posSrc = y * bytesPerLineSrc + x * channelsSrc;
 			posDst = y * bytesPerLineDst + x * channelsDst;
@@ -582,6 +691,288 @@ int vc_hsv_segmentation(IVC* src, IVC* dst, int hmin, int hmax, int smin, int sm
 	return 1;
 }
 
+// Converte um intervalo HSV (H em graus, S e V em %) para a escala [0, 255] da imagem HSV,
+// com os mesmos arredondamentos de vc_hsv_segmentation
+static int vc_hsv_range_to_bytes(const HVC* range, int* limits)
+{
+	if (!(range->hmin >= 0 && range->hmax <= 360)) return 0;
+	if (!(range->smin >= 0 && range->smax <= 255)) return 0;
+	if (!(range->vmin >= 0 && range->vmax <= 255)) return 0;
+
+	limits[0] = ((float)range->hmin * 255) / 360;
+	limits[1] = ((float)range->hmax * 255) / 360;
+	limits[2] = ((float)range->smin * 255) / 100;
+	limits[3] = ((float)range->smax * 255) / 100;
+	limits[4] = ((float)range->vmin * 255) / 100;
+	limits[5] = ((float)range->vmax * 255) / 100;
+
+	return 1;
+}
+
+// Classe de um pixel RGB: índice+1 do primeiro intervalo (já em bytes) que o contém, ou 0
+static int vc_pixel_hsv_class(unsigned char r, unsigned char g, unsigned char b, int limits[][6], int nranges)
+{
+	unsigned char hsv[3];
+	int k;
+
+	vc_pixel_rgb_to_hsv(r, g, b, hsv);
+
+	for (k = 0; k < nranges; k++)
+	{
+		if (hsv[0] >= limits[k][0] && hsv[0] <= limits[k][1] &&
+			hsv[1] >= limits[k][2] && hsv[1] <= limits[k][3] &&
+			hsv[2] >= limits[k][4] && hsv[2] <= limits[k][5])
+		{
+			return k + 1;
+		}
+	}
+
+	return 0;
+}
+
+// Conversão para HSV e segmentação por vários intervalos numa só passagem
+// src		: Imagem RGB/BGR (3 canais)
+// dst		: Máscara binária (0/255) com a união de todos os intervalos
+// labels	: Opcional (NULL); recebe o índice+1 do primeiro intervalo que contém o pixel, ou 0
+// ranges	: Tabela de nranges intervalos (no máximo VC_MAX_HSV_RANGES)
+// Equivale a vc_rgb_to_hsv + vc_hsv_segmentation por intervalo + vc_join_segmentations, sem imagem HSV
+static int vc_hsv_segmentation_multi_order(IVC* src, IVC* dst, IVC* labels, const HVC* ranges, int nranges, int ir, int ib)
+{
+	unsigned char* dataSrc = (unsigned char*)src->data;
+	unsigned char* dataDst = (unsigned char*)dst->data;
+	unsigned char* dataLabels = (labels != NULL) ? (unsigned char*)labels->data : NULL;
+	int bytesPerLineSrc = src->bytesperline;
+	int bytesPerLineDst = dst->bytesperline;
+	int bytesPerLineLabels = (labels != NULL) ? labels->bytesperline : 0;
+	int width = src->width;
+	int height = src->height;
+	int limits[VC_MAX_HSV_RANGES][6];
+	const VCSIMD* simd = vc_simd();
+	unsigned char* pSrc;
+	int x, y, k, label;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 3) || (dst->channels != 1)) return 0;
+	if (dst->levels != 255) return 0;
+	if ((nranges <= 0) || (nranges > VC_MAX_HSV_RANGES)) return 0;
+	if ((labels != NULL) && ((labels->width != width) || (labels->height != height) || (labels->channels != 1))) return 0;
+
+	for (k = 0; k < nranges; k++)
+	{
+		if (!vc_hsv_range_to_bytes(&ranges[k], limits[k])) return 0;
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		x = 0;
+		if (simd->rgb_hsv_class != NULL)
+		{
+			x = simd->rgb_hsv_class(&dataSrc[y * bytesPerLineSrc], &dataDst[y * bytesPerLineDst], (dataLabels != NULL) ? &dataLabels[y * bytesPerLineLabels] : NULL, width, ir, ib, (const int (*)[6])limits, nranges);
+		}
+
+		pSrc = &dataSrc[y * bytesPerLineSrc + x * 3];
+
+		for (; x < width; x++, pSrc += 3)
+		{
+			label = vc_pixel_hsv_class(pSrc[ir], pSrc[1], pSrc[ib], limits, nranges);
+
+			dataDst[y * bytesPerLineDst + x] = (label != 0) ? 255 : 0;
+			if (dataLabels != NULL) dataLabels[y * bytesPerLineLabels + x] = (unsigned char)label;
+		}
+	}
+
+	return 1;
+}
+
+int vc_rgb_hsv_segmentation_multi(IVC* src, IVC* dst, IVC* labels, const HVC* ranges, int nranges)
+{
+	return vc_hsv_segmentation_multi_order(src, dst, labels, ranges, nranges, 0, 2);
+}
+
+int vc_bgr_hsv_segmentation_multi(IVC* src, IVC* dst, IVC* labels, const HVC* ranges, int nranges)
+{
+	return vc_hsv_segmentation_multi_order(src, dst, labels, ranges, nranges, 2, 0);
+}
+
+// Criar a tabela de classificação de cor a partir dos intervalos HSV
+// bits		: Bits por canal do RGB quantizado (5 -> 32K entradas, 6 -> 256K, 8 -> exata)
+// Cada célula recebe a classe do RGB do seu centro, calculada com o mesmo código da segmentação fundida
+CVC *vc_colour_lut_new(const HVC* ranges, int nranges, int bits)
+{
+	CVC *lut;
+	int limits[VC_MAX_HSV_RANGES][6];
+	int shift, half, size, qr, qg, qb, k;
+	unsigned char *p;
+
+	if ((bits < 1) || (bits > 8)) return NULL;
+	if ((nranges <= 0) || (nranges > VC_MAX_HSV_RANGES)) return NULL;
+
+	for (k = 0; k < nranges; k++)
+	{
+		if (!vc_hsv_range_to_bytes(&ranges[k], limits[k])) return NULL;
+	}
+
+	lut = (CVC *) malloc(sizeof(CVC));
+	if (lut == NULL) return NULL;
+
+	size = 1 << (3 * bits);
+	lut->bits = bits;
+	lut->table = (unsigned char *) malloc(size);
+	if (lut->table == NULL)
+	{
+		free(lut);
+		return NULL;
+	}
+
+	shift = 8 - bits;
+	half = (shift > 0) ? (1 << (shift - 1)) : 0;
+	p = lut->table;
+
+	for (qr = 0; qr < (1 << bits); qr++)
+	{
+		for (qg = 0; qg < (1 << bits); qg++)
+		{
+			for (qb = 0; qb < (1 << bits); qb++)
+			{
+				*p++ = (unsigned char)vc_pixel_hsv_class((qr << shift) | half, (qg << shift) | half, (qb << shift) | half, limits, nranges);
+			}
+		}
+	}
+
+	return lut;
+}
+
+
+// Libertar a tabela de classificação de cor
+CVC *vc_colour_lut_free(CVC *lut)
+{
+	if (lut != NULL)
+	{
+		if (lut->table != NULL) free(lut->table);
+		free(lut);
+		lut = NULL;
+	}
+
+	return lut;
+}
+
+
+// Segmentação por tabela: uma leitura da tabela por pixel, sem cálculo HSV
+// Mesmas saídas que vc_*_hsv_segmentation_multi (dst 0/255, labels opcional com a classe)
+static int vc_lut_segmentation_order(IVC* src, IVC* dst, IVC* labels, const CVC* lut, int ir, int ib)
+{
+	unsigned char* dataSrc = (unsigned char*)src->data;
+	unsigned char* dataDst = (unsigned char*)dst->data;
+	unsigned char* dataLabels = (labels != NULL) ? (unsigned char*)labels->data : NULL;
+	int bytesPerLineSrc = src->bytesperline;
+	int bytesPerLineDst = dst->bytesperline;
+	int bytesPerLineLabels = (labels != NULL) ? labels->bytesperline : 0;
+	int width = src->width;
+	int height = src->height;
+	int shift, bits;
+	unsigned char* pSrc;
+	unsigned char label;
+	int x, y;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 3) || (dst->channels != 1)) return 0;
+	if ((lut == NULL) || (lut->table == NULL)) return 0;
+	if ((labels != NULL) && ((labels->width != width) || (labels->height != height) || (labels->channels != 1))) return 0;
+
+	bits = lut->bits;
+	shift = 8 - bits;
+
+	for (y = 0; y < height; y++)
+	{
+		pSrc = &dataSrc[y * bytesPerLineSrc];
+
+		for (x = 0; x < width; x++, pSrc += 3)
+		{
+			label = lut->table[((pSrc[ir] >> shift) << (2 * bits)) | ((pSrc[1] >> shift) << bits) | (pSrc[ib] >> shift)];
+
+			dataDst[y * bytesPerLineDst + x] = (label != 0) ? 255 : 0;
+			if (dataLabels != NULL) dataLabels[y * bytesPerLineLabels + x] = label;
+		}
+	}
+
+	return 1;
+}
+
+int vc_rgb_lut_segmentation(IVC* src, IVC* dst, IVC* labels, const CVC* lut)
+{
+	return vc_lut_segmentation_order(src, dst, labels, lut, 0, 2);
+}
+
+int vc_bgr_lut_segmentation(IVC* src, IVC* dst, IVC* labels, const CVC* lut)
+{
+	return vc_lut_segmentation_order(src, dst, labels, lut, 2, 0);
+}
+
+
+// Modo de validação: compara a tabela com o cálculo HSV exato em todos os pixels de src
+// Devolve o número de pixels com classe diferente (-1 em caso de erro)
+static long int vc_colour_lut_validate_order(IVC* src, const CVC* lut, const HVC* ranges, int nranges, int ir, int ib)
+{
+	unsigned char* dataSrc = (unsigned char*)src->data;
+	int bytesPerLineSrc = src->bytesperline;
+	int width = src->width;
+	int height = src->height;
+	int limits[VC_MAX_HSV_RANGES][6];
+	int shift, bits, exact, approx;
+	long int mismatches = 0;
+	unsigned char* pSrc;
+	int x, y, k;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return -1;
+	if (src->channels != 3) return -1;
+	if ((lut == NULL) || (lut->table == NULL)) return -1;
+	if ((nranges <= 0) || (nranges > VC_MAX_HSV_RANGES)) return -1;
+
+	for (k = 0; k < nranges; k++)
+	{
+		if (!vc_hsv_range_to_bytes(&ranges[k], limits[k])) return -1;
+	}
+
+	bits = lut->bits;
+	shift = 8 - bits;
+
+	for (y = 0; y < height; y++)
+	{
+		pSrc = &dataSrc[y * bytesPerLineSrc];
+
+		for (x = 0; x < width; x++, pSrc += 3)
+		{
+			exact = vc_pixel_hsv_class(pSrc[ir], pSrc[1], pSrc[ib], limits, nranges);
+			approx = lut->table[((pSrc[ir] >> shift) << (2 * bits)) | ((pSrc[1] >> shift) << bits) | (pSrc[ib] >> shift)];
+
+			if (exact != approx)
+			{
+				#ifdef VC_DEBUG
+				if (mismatches == 0)
+				{
+					printf("vc_colour_lut_validate(): (%d,%d) RGB=(%d,%d,%d) exata=%d tabela=%d\n", x, y, pSrc[ir], pSrc[1], pSrc[ib], exact, approx);
+				}
+				#endif
+				mismatches++;
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+long int vc_rgb_colour_lut_validate(IVC* src, const CVC* lut, const HVC* ranges, int nranges)
+{
+	return vc_colour_lut_validate_order(src, lut, ranges, nranges, 0, 2);
+}
+
+long int vc_bgr_colour_lut_validate(IVC* src, const CVC* lut, const HVC* ranges, int nranges)
+{
+	return vc_colour_lut_validate_order(src, lut, ranges, nranges, 2, 0);
+}
+
 int vc_scale_gray_to_color_pallette(IVC* src, IVC* dst)
 {
 	unsigned char* dataSrc = (unsigned char*)src->data;
@@ -684,14 +1075,21 @@ int vc_gray_to_binary(IVC* src, IVC* dst, int treshold)
 	int height = src->height;
 	long int posSrc, posDst;
 	float temp;
+	const VCSIMD* simd = vc_simd();
+	int x, lo;
 
 	if (src->width <= 0 || src->height <= 0)return 0;
 	if (src->width != dst->width || src->height != dst->height)return 0;
 	if ((src->channels != 1) || (dst->channels != 1)) return 0;
 
+	// temp > treshold <=> treshold + 1 <= temp <= 255
+	lo = (treshold < 255) ? treshold + 1 : 256;
+
 	for (int y = 0; y < height; y++)
 	{
-		for (int x = 0; x < width; x++)
+		x = (simd->gray_inrange != NULL) ? simd->gray_inrange(&dataSrc[y * bytesPerLineSrc], &dataDst[y * bytesPerLineDst], width, lo, 255) : 0;
+
+		for (; x < width; x++)
 		{
 			posSrc = y * bytesPerLineSrc + x * channelsSrc;
 			posDst = y * bytesPerLineDst + x * channelsDst;
@@ -725,6 +1123,8 @@ int vc_gray_to_binary_global_mean(IVC* src, IVC* dst)
 	int treshold;
 	int count = 0;
 	float temp = 0;
+	const VCSIMD* simd = vc_simd();
+	int x, lo;
 
 	if ((src->width <= 0) || (src->height <= 0))return 0;
 	if ((src->width != dst->width) || (src->height != dst->height))return 0;
@@ -732,7 +1132,7 @@ int vc_gray_to_binary_global_mean(IVC* src, IVC* dst)
 
 	for (int y = 0; y < height; y++)
 	{
-		for (int x = 0; x < width; x++)
+		for (x = 0; x < width; x++)
 		{
 			posSrc = y * bytesPerLineSrc + x * channelsSrc;
 
@@ -744,9 +1144,14 @@ int vc_gray_to_binary_global_mean(IVC* src, IVC* dst)
 
 	treshold = temp / count;
 
+	// temp > treshold <=> treshold + 1 <= temp <= 255
+	lo = (treshold < 255) ? treshold + 1 : 256;
+
 	for (int y = 0; y < height; y++)
 	{
-		for (int x = 0; x < width; x++)
+		x = (simd->gray_inrange != NULL) ? simd->gray_inrange(&dataSrc[y * bytesPerLineSrc], &dataDst[y * bytesPerLineDst], width, lo, 255) : 0;
+
+		for (; x < width; x++)
 		{
 			posSrc = y * bytesPerLineSrc + x * channelsSrc;
 			posDst = y * bytesPerLineDst + x * channelsDst;
@@ -819,148 +1224,431 @@ vc_gray_to_binary_midpoint(IVC* src, IVC* dst, int kernel)
 	return 1;
 }
 
-int vc_binary_dilate(IVC* src, IVC* dst, int kernel)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//    MORFOLOGIA BINÁRIA: PASSAGENS SEPARÁVEIS (VAN HERK/GIL-WERMAN)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// A dilatação marca os pixels com algum 255 na vizinhança; a erosão apaga os pixels com algum 0.
+// Ambas se reduzem a um máximo deslizante sobre f = (src == value) ? 255 : 0 (value = 255 na dilatação,
+// 0 na erosão, cujo resultado é depois invertido). Fora da imagem f = 0, o que equivale a ignorar a vizinhança
+// fora da imagem. O máximo de uma janela de k = 2o+1 elementos usa o algoritmo de van Herk/Gil-Werman:
+// máximos por blocos de k desde o início (g) e desde o fim (h) do bloco, e max(h[i], g[i + k - 1]),
+// ou seja, cerca de 3 comparações por pixel independentemente de k (para k <= 5 compara-se diretamente).
+
+// Criar o espaço de trabalho da morfologia para imagens width x height
+MVC *vc_morph_new(int width, int height)
 {
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline = src->width * src->channels;
-	int channels_src = src->channels;
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-	int width = src->width;
-	int height = src->height;
-	int x, y, nx, ny, flag;
-	long int pos_src, pos_src_for, pos_dst;
-	float threshold = 0;
+	MVC *ws;
 
-	//Verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
-	int offset = (int)(kernel) / 2;
+	if ((width <= 0) || (height <= 0)) return NULL;
 
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
+	ws = (MVC *)calloc(1, sizeof(MVC));
+	if (ws == NULL) return NULL;
+
+	ws->width = width;
+	ws->height = height;
+	ws->row = (unsigned char *)malloc(width * height * sizeof(unsigned char));
+	ws->acc = (unsigned char *)malloc(width * height * sizeof(unsigned char));
+
+	if ((ws->row == NULL) || (ws->acc == NULL)) return vc_morph_free(ws);
+
+	return ws;
+}
+
+MVC *vc_morph_free(MVC *ws)
+{
+	if (ws != NULL)
+	{
+		free(ws->row);
+		free(ws->acc);
+		free(ws->g);
+		free(ws->h);
+		free(ws);
+	}
+
+	return NULL;
+}
+
+// Garante que g e h têm espaço para uma janela de meia-largura o (nas duas direções)
+static int vc_morph_reserve(MVC *ws, int o)
+{
+	int k = 2 * o + 1;
+	long int mh = (long int)((ws->width + 2 * o + k - 1) / k) * k;
+	long int mv = (long int)k * ws->width;
+	long int size = MAX(mh, mv);
+	unsigned char *g, *h;
+
+	if (size <= ws->size) return 1;
+
+	g = (unsigned char *)realloc(ws->g, size);
+	if (g == NULL) return 0;
+	ws->g = g;
+
+	h = (unsigned char *)realloc(ws->h, size);
+	if (h == NULL) return 0;
+	ws->h = h;
+
+	ws->size = size;
+
+	return 1;
+}
+
+// Passagem horizontal: ws->row(x, y) = max de f(x - o .. x + o, y), com f = (src == value) ? 255 : 0
+static void vc_morph_rows(IVC* src, unsigned char value, int o, MVC* ws)
+{
+	int width = src->width;
+	int height = src->height;
+	int k = 2 * o + 1;
+	int m = ((width + 2 * o + k - 1) / k) * k;
+	unsigned char *g = ws->g;
+	unsigned char *f = ws->h;
+	unsigned char *s, *out, v;
+	int x, y, i, j, d;
+
+	for (y = 0; y < height; y++)
+	{
+		s = &src->data[y * src->bytesperline];
+		out = &ws->row[y * width];
+
+		// Linha f com o zeros de margem de cada lado (e até completar o último bloco)
+		memset(f, 0, o);
+		for (x = 0; x < width; x++) f[o + x] = (s[x] == value) ? 255 : 0;
+		memset(&f[o + width], 0, m - o - width);
+
+		if (o <= 2)
 		{
-			pos_src = y * bytesperline + x * channels_src;
-			pos_dst = y * bytesperline + x * channels_dst;
-			flag = 0;
-			for (ny = y - offset; ny <= y + offset; ny++)
+			// Janelas pequenas: comparar diretamente é mais rápido que os blocos
+			for (x = 0; x < width; x++)
 			{
-				for (nx = x - offset; nx <= x + offset; nx++)
-				{
+				v = f[x];
+				for (d = 1; d < k; d++) v = MAX(v, f[x + d]);
+				out[x] = v;
+			}
+			continue;
+		}
 
-					if (nx >= 0 && nx < width && ny >= 0 && ny < height)
-					{
+		// g: máximo desde o início do bloco
+		for (i = 0, j = 0; i < m; i++, j++)
+		{
+			if (j == k) j = 0;
+			g[i] = (j == 0) ? f[i] : MAX(g[i - 1], f[i]);
+		}
 
-						pos_src_for = (ny)*bytesperline + (nx)*channels_src;
-						if (datasrc[pos_src_for] == 255)
-						{
-							flag = 1;
-						}
+		// f passa a h: máximo até ao fim do bloco
+		for (i = m - 2, j = (m - 2) % k; i >= 0; i--, j--)
+		{
+			if (j < 0) j = k - 1;
+			if (j != k - 1) f[i] = MAX(f[i], f[i + 1]);
+		}
 
-					}
-				}
+		for (x = 0; x < width; x++)
+		{
+			out[x] = MAX(f[x], g[x + 2 * o]);
+		}
+	}
+}
+
+// Linha i da coluna com margem de o linhas (NULL fora da imagem, equivale a zeros)
+static unsigned char* vc_morph_row_at(MVC* ws, int i, int o)
+{
+	int sy = i - o;
+
+	return ((sy >= 0) && (sy < ws->height)) ? &ws->row[sy * ws->width] : NULL;
+}
+
+// dst = max(a, v), com NULL a valer uma linha de zeros
+static void vc_morph_max_rows(unsigned char* dst, const unsigned char* a, const unsigned char* v, int width)
+{
+	int x;
+
+	if ((a == NULL) || (v == NULL))
+	{
+		if (a == NULL) a = v;
+		if (a == NULL) memset(dst, 0, width);
+		else if (a != dst) memcpy(dst, a, width);
+		return;
+	}
+
+	for (x = 0; x < width; x++) dst[x] = MAX(a[x], v[x]);
+}
+
+// Passagem vertical sobre ws->row, linha a linha (acessos contíguos); escreve em dst, invertendo se pedido.
+// Processa um bloco de k linhas de cada vez: h do bloco atual e g do seguinte (2k linhas de buffer)
+static void vc_morph_cols(MVC* ws, int o, unsigned char* dst, int bytesperline_dst, int invert)
+{
+	int width = ws->width;
+	int height = ws->height;
+	int k = 2 * o + 1;
+	unsigned char *g = ws->g;
+	unsigned char *h = ws->h;
+	unsigned char *hj, *gj, *out;
+	unsigned char mask = invert ? 255 : 0;
+	int x, y, j, d, base;
+
+	if (o <= 2)
+	{
+		for (y = 0; y < height; y++)
+		{
+			out = &dst[y * bytesperline_dst];
+
+			memcpy(out, &ws->row[y * width], width);
+			for (d = 1; d <= o; d++)
+			{
+				if (y - d >= 0) vc_morph_max_rows(out, out, &ws->row[(y - d) * width], width);
+				if (y + d < height) vc_morph_max_rows(out, out, &ws->row[(y + d) * width], width);
 			}
-			if (flag == 1) {
-				datadst[pos_dst] = 255;
+			if (invert) for (x = 0; x < width; x++) out[x] ^= mask;
+		}
+		return;
+	}
+
+	// h do primeiro bloco
+	for (j = k - 1; j >= 0; j--)
+	{
+		vc_morph_max_rows(&h[j * width], (j < k - 1) ? &h[(j + 1) * width] : NULL, vc_morph_row_at(ws, j, o), width);
+	}
+
+	for (base = 0; base < height; base += k)
+	{
+		// g do bloco seguinte (só as primeiras k - 1 linhas são usadas)
+		for (j = 0; j < k - 1; j++)
+		{
+			vc_morph_max_rows(&g[j * width], (j > 0) ? &g[(j - 1) * width] : NULL, vc_morph_row_at(ws, base + k + j, o), width);
+		}
+
+		// A janela da linha base + j vai de h[j] (bloco atual) a g[j - 1] (bloco seguinte)
+		for (j = 0; (j < k) && (base + j < height); j++)
+		{
+			out = &dst[(base + j) * bytesperline_dst];
+			hj = &h[j * width];
+
+			if (j == 0)
+			{
+				for (x = 0; x < width; x++) out[x] = hj[x] ^ mask;
 			}
-			else {
-				datadst[pos_dst] = 0;
+			else
+			{
+				gj = &g[(j - 1) * width];
+				for (x = 0; x < width; x++) out[x] = MAX(hj[x], gj[x]) ^ mask;
 			}
 		}
+
+		// h do bloco seguinte
+		for (j = k - 1; j >= 0; j--)
+		{
+			vc_morph_max_rows(&h[j * width], (j < k - 1) ? &h[(j + 1) * width] : NULL, vc_morph_row_at(ws, base + k + j, o), width);
+		}
 	}
 }
 
-int vc_binary_erode(IVC* src, IVC* dst, int kernel)
+// Elemento em disco de raio r = kernel / 2 (pixels com dx^2 + dy^2 <= r^2):
+// cada linha dy do disco é um segmento horizontal de meia-largura w(dy), por isso o resultado é o máximo,
+// para cada dy, da passagem horizontal com meia-largura w(dy) deslocada dy linhas.
+// Cada w distinto exige uma passagem horizontal O(1) por pixel, e cada dy uma passagem de máximos.
+static void vc_morph_disk(IVC* src, unsigned char value, int r, MVC* ws, unsigned char* dst, int bytesperline_dst, int invert)
 {
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline = src->width * src->channels;
-	int channels_src = src->channels;
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-	int width = src->width;
-	int height = src->height;
-	int x, y, nx, ny, flag;
-	long int pos_src, pos_src_for, pos_dst;
-	float threshold = 0;
+	int width = ws->width;
+	int height = ws->height;
+	unsigned char mask = invert ? 255 : 0;
+	unsigned char *acc, *row, *out;
+	int a, b, w, dy, y, sy, x, sign;
 
-	//Verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
-	int offset = (int)(kernel) / 2;
+	memset(ws->acc, 0, width * height);
 
-	for (y = 0; y < height; y++)
+	for (a = 0; a <= r; a = b + 1)
 	{
-		for (x = 0; x < width; x++)
+		// Linhas a..b do disco (e -b..-a) têm todas a mesma meia-largura w
+		for (w = r; w * w + a * a > r * r; w--);
+		for (b = a; (b + 1 <= r) && (w * w + (b + 1) * (b + 1) <= r * r) && ((w + 1) * (w + 1) + (b + 1) * (b + 1) > r * r); b++);
+
+		vc_morph_rows(src, value, w, ws);
+
+		for (dy = a; dy <= b; dy++)
 		{
-			pos_src = y * bytesperline + x * channels_src;
-			pos_dst = y * bytesperline + x * channels_dst;
-			flag = 0;
-			for (ny = y - offset; ny <= y + offset; ny++)
+			for (sign = 1; sign >= -1; sign -= 2)
 			{
-				for (nx = x - offset; nx <= x + offset; nx++)
-				{
-
-					if (nx >= 0 && nx < width && ny >= 0 && ny < height)
-					{
+				if ((dy == 0) && (sign < 0)) continue;
 
-						pos_src_for = (ny)*bytesperline + (nx)*channels_src;
-						if (datasrc[pos_src_for] == 0)
-						{
-							flag = 1;
-						}
+				for (y = 0; y < height; y++)
+				{
+					sy = y + sign * dy;
+					if ((sy < 0) || (sy >= height)) continue;
 
-					}
+					acc = &ws->acc[y * width];
+					row = &ws->row[sy * width];
+					for (x = 0; x < width; x++) acc[x] = MAX(acc[x], row[x]);
 				}
 			}
-			if (flag == 1) {
-				datadst[pos_dst] = 0;
-			}
-			else {
-				datadst[pos_dst] = 255;
-			}
 		}
 	}
+
+	for (y = 0; y < height; y++)
+	{
+		acc = &ws->acc[y * width];
+		out = &dst[y * bytesperline_dst];
+		for (x = 0; x < width; x++) out[x] = acc[x] ^ mask;
+	}
+}
+
+static int vc_binary_morph(IVC* src, IVC* dst, int kernel, int shape, MVC* ws, unsigned char value, int invert)
+{
+	int offset = kernel / 2;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+	if ((ws == NULL) || (ws->width != src->width) || (ws->height != src->height)) return 0;
+	if (offset < 0) offset = 0;
+	if (!vc_morph_reserve(ws, offset)) return 0;
+
+	if (shape == VC_MORPH_DISK)
+	{
+		vc_morph_disk(src, value, offset, ws, dst->data, dst->bytesperline, invert);
+	}
+	else
+	{
+		vc_morph_rows(src, value, offset, ws);
+		vc_morph_cols(ws, offset, dst->data, dst->bytesperline, invert);
+	}
+
+	return 1;
+}
+
+// Dilatação com elemento quadrado (VC_MORPH_SQUARE, lado kernel) ou em disco (VC_MORPH_DISK, diâmetro kernel)
+int vc_binary_dilate_ws(IVC* src, IVC* dst, int kernel, int shape, MVC* ws)
+{
+	return vc_binary_morph(src, dst, kernel, shape, ws, 255, 0);
+}
+
+// Erosão: o complemento da dilatação dos pixels a 0
+int vc_binary_erode_ws(IVC* src, IVC* dst, int kernel, int shape, MVC* ws)
+{
+	return vc_binary_morph(src, dst, kernel, shape, ws, 0, 1);
+}
+
+int vc_binary_dilate(IVC* src, IVC* dst, int kernel)
+{
+	MVC* ws;
+	int ret;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+
+	ws = vc_morph_new(src->width, src->height);
+	if (ws == NULL)
+	{
+		printf("ERROR -> vc_binary_dilate():\n\tOut of memory!\n");
+		return 0;
+	}
+
+	ret = vc_binary_dilate_ws(src, dst, kernel, VC_MORPH_SQUARE, ws);
+
+	vc_morph_free(ws);
+
+	return ret;
+}
+
+int vc_binary_erode(IVC* src, IVC* dst, int kernel)
+{
+	MVC* ws;
+	int ret;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+
+	ws = vc_morph_new(src->width, src->height);
+	if (ws == NULL)
+	{
+		printf("ERROR -> vc_binary_erode():\n\tOut of memory!\n");
+		return 0;
+	}
+
+	ret = vc_binary_erode_ws(src, dst, kernel, VC_MORPH_SQUARE, ws);
+
+	vc_morph_free(ws);
+
+	return ret;
 }
 
 int vc_binary_open(IVC* src, IVC* dst, int kernel) 
 {
 	IVC* temp;
+	int ret;
 
 	temp = vc_image_new(src->width, src->height, 1, 255);
 	if (temp == NULL)
 	{
-		printf("ERROR -> vc_read_image():\n\Out of memory!\n");
+		printf("ERROR -> vc_binary_open():\n\tOut of memory!\n");
 		(void)getchar();
 		return 0;
 	}
 
-	vc_binary_erode(src, temp, kernel);
-	vc_binary_dilate(temp, dst, kernel);
+	ret = vc_binary_open_tmp(src, dst, temp, kernel);
+
+	vc_image_free(temp);
 
-	free(temp);
+	return ret;
 }
 
 int vc_binary_close(IVC* src, IVC* dst, int kernel)
 {
 	IVC* temp;
+	int ret;
 
 	temp = vc_image_new(src->width, src->height, 1, 255);
 	if (temp == NULL)
 	{
-		printf("ERROR -> vc_read_image():\n\Out of memory!\n");
+		printf("ERROR -> vc_binary_close():\n\tOut of memory!\n");
 		(void)getchar();
 		return 0;
 	}
 	
-	vc_binary_dilate(src, temp, kernel);
-	vc_binary_erode(temp, dst, kernel);
+	ret = vc_binary_close_tmp(src, dst, temp, kernel);
+
+	vc_image_free(temp);
+
+	return ret;
+}
+
+// Abertura usando uma imagem temporária do chamador (os buffers da morfologia são alocados por chamada; ver vc_binary_open_ws)
+int vc_binary_open_tmp(IVC* src, IVC* dst, IVC* tmp, int kernel)
+{
+	if ((tmp == NULL) || (tmp->width != src->width) || (tmp->height != src->height) || (tmp->channels != 1)) return 0;
+
+	vc_binary_erode(src, tmp, kernel);
+	vc_binary_dilate(tmp, dst, kernel);
 
-	free(temp);
+	return 1;
+}
+
+// Fecho usando uma imagem temporária do chamador (os buffers da morfologia são alocados por chamada; ver vc_binary_close_ws)
+int vc_binary_close_tmp(IVC* src, IVC* dst, IVC* tmp, int kernel)
+{
+	if ((tmp == NULL) || (tmp->width != src->width) || (tmp->height != src->height) || (tmp->channels != 1)) return 0;
+
+	vc_binary_dilate(src, tmp, kernel);
+	vc_binary_erode(tmp, dst, kernel);
+
+	return 1;
+}
+
+// Abertura com elemento quadrado ou em disco, sem qualquer alocação (tmp e ws pertencem ao chamador)
+int vc_binary_open_ws(IVC* src, IVC* dst, IVC* tmp, int kernel, int shape, MVC* ws)
+{
+	if ((tmp == NULL) || (tmp->width != src->width) || (tmp->height != src->height) || (tmp->channels != 1)) return 0;
+
+	if (!vc_binary_erode_ws(src, tmp, kernel, shape, ws)) return 0;
+
+	return vc_binary_dilate_ws(tmp, dst, kernel, shape, ws);
+}
+
+// Fecho com elemento quadrado ou em disco, sem qualquer alocação (tmp e ws pertencem ao chamador)
+int vc_binary_close_ws(IVC* src, IVC* dst, IVC* tmp, int kernel, int shape, MVC* ws)
+{
+	if ((tmp == NULL) || (tmp->width != src->width) || (tmp->height != src->height) || (tmp->channels != 1)) return 0;
+
+	if (!vc_binary_dilate_ws(src, tmp, kernel, shape, ws)) return 0;
+
+	return vc_binary_erode_ws(tmp, dst, kernel, shape, ws);
 }
 
 int vc_gray_to_binary2(IVC* src, IVC* dst, int treshold1, int treshold2)
@@ -975,14 +1663,22 @@ int vc_gray_to_binary2(IVC* src, IVC* dst, int treshold1, int treshold2)
 	int height = src->height;
 	long int posSrc, posDst;
 	float temp;
+	const VCSIMD* simd = vc_simd();
+	int x, lo, hi;
 
 	if (src->width <= 0 || src->height <= 0)return 0;
 	if (src->width != dst->width || src->height != dst->height)return 0;
 	if ((src->channels != 1) || (dst->channels != 1)) return 0;
 
+	// treshold1 < temp < treshold2 <=> treshold1 + 1 <= temp <= treshold2 - 1
+	lo = (treshold1 < 255) ? treshold1 + 1 : 256;
+	hi = (treshold2 > 0) ? treshold2 - 1 : -1;
+
 	for (int y = 0; y < height; y++)
 	{
-		for (int x = 0; x < width; x++)
+		x = (simd->gray_inrange != NULL) ? simd->gray_inrange(&dataSrc[y * bytesPerLineSrc], &dataDst[y * bytesPerLineDst], width, lo, hi) : 0;
+
+		for (; x < width; x++)
 		{
 			posSrc = y * bytesPerLineSrc + x * channelsSrc;
 			posDst = y * bytesPerLineDst + x * channelsDst;
@@ -1100,6 +1796,65 @@ int vc_binary_blob_labelling(IVC* src, IVC* dst)
 	return 1;
 }
 
+// Alocar o espaço de trabalho da etiquetagem para imagens width x height
+LVC *vc_labelling_new(int width, int height)
+{
+	LVC *ws = (LVC *) malloc(sizeof(LVC));
+	long int size;
+
+	if(ws == NULL) return NULL;
+	if((width <= 0) || (height <= 0)) { free(ws); return NULL; }
+
+	size = (long int) width * height;
+
+	ws->width = width;
+	ws->height = height;
+	// Com vizinhança-8, cada etiqueta provisória nova precisa de um pixel sem vizinhos já etiquetados,
+	// por isso há no máximo uma por cada bloco 2x2
+	ws->maxlabels = ((width + 1) / 2) * ((height + 1) / 2) + 1;
+	ws->labels = (unsigned int *) malloc(size * sizeof(unsigned int));
+	ws->labeltable = (int *) malloc(ws->maxlabels * sizeof(int));
+	ws->blobs = NULL;
+	ws->sums = NULL;
+	ws->maxblobs = 0;
+	ws->nblobs = -1;
+	ws->strips = NULL;
+	ws->maxstrips = 0;
+	ws->nstrips = 0;
+	ws->partial = NULL;
+	ws->partialsums = NULL;
+	ws->maxpartial = 0;
+
+	if((ws->labels == NULL) || (ws->labeltable == NULL))
+	{
+		return vc_labelling_free(ws);
+	}
+
+	return ws;
+}
+
+
+// Libertar o espaço de trabalho da etiquetagem
+LVC *vc_labelling_free(LVC *ws)
+{
+	if(ws != NULL)
+	{
+		if(ws->labels != NULL) free(ws->labels);
+		if(ws->labeltable != NULL) free(ws->labeltable);
+		if(ws->blobs != NULL) free(ws->blobs);
+		if(ws->sums != NULL) free(ws->sums);
+		if(ws->strips != NULL) free(ws->strips);
+		if(ws->partial != NULL) free(ws->partial);
+		if(ws->partialsums != NULL) free(ws->partialsums);
+
+		free(ws);
+		ws = NULL;
+	}
+
+	return ws;
+}
+
+
 // Etiquetagem de blobs
 // src		: Imagem de entrada
 // dst		: Imagem que irá conter as etiquetas
@@ -1108,264 +1863,661 @@ int vc_binary_blob_labelling(IVC* src, IVC* dst)
 // Versão melhorada, esta suporta mais do que 255 labels
 OVC* vc_binary_blob_labelling2(IVC* src, IVC* dst, int* nlabels)
 {
-	unsigned char* datasrc = (unsigned char*)src->data;
-	unsigned int* datadst_int; 
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->bytesperline;
-	int channels = src->channels;
-	int x, y, a, b;
-	long int i, size;
-	long int posX, posA, posB, posC, posD;
-	int* labeltable;
-	int* labelarea;
-	int* labelperimeter; 
-	int label = 1; 
-	int num, tmplabel;
-	OVC* blobs; 
+	LVC* ws;
+	OVC* blobs;
+	OVC* wsblobs;
 
-	
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels)) return NULL;
-	if (channels != 1) return NULL;
+	*nlabels = 0;
 
-	
-	datadst_int = (unsigned int*)malloc(width * height * sizeof(unsigned int));
-	if (datadst_int == NULL) return NULL;
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return NULL;
 
-	memset(datadst_int, 0, width * height * sizeof(unsigned int));
+	ws = vc_labelling_new(src->width, src->height);
+	if (ws == NULL) return NULL;
 
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			if (datasrc[y * bytesperline + x * channels] != 0) {
-				datadst_int[y * width + x] = 65535; 
-			}
-		}
-	}
-	
-	labeltable = (int*)malloc((width * height + 1) * sizeof(int));
-	labelarea = (int*)malloc((width * height + 1) * sizeof(int));
-	labelperimeter = (int*)malloc((width * height + 1) * sizeof(int)); 
-	if (labeltable == NULL || labelarea == NULL || labelperimeter == NULL) {
-		free(datadst_int);
-		if (labeltable) free(labeltable);
-		if (labelarea) free(labelarea);
-		if (labelperimeter) free(labelperimeter);
+	wsblobs = vc_binary_blob_labelling3(src, dst, NULL, nlabels, ws);
+	if (wsblobs == NULL)
+	{
+		vc_labelling_free(ws);
 		return NULL;
 	}
-	
-	for (i = 0; i <= width * height; i++) {
-		labeltable[i] = i;
-		labelarea[i] = 0;
-		labelperimeter[i] = 0; 
-	}
 
-	for (y = 0; y < height; y++) {
-		datadst_int[y * width + 0] = 0;
-		datadst_int[y * width + (width - 1)] = 0;
-	}
-	for (x = 0; x < width; x++) {
-		datadst_int[0 * width + x] = 0;
-		datadst_int[(height - 1) * width + x] = 0;
-	}
+	blobs = (OVC*)calloc((*nlabels), sizeof(OVC));
+	if (blobs != NULL) memcpy(blobs, wsblobs, (*nlabels) * sizeof(OVC));
 
-	for (y = 1; y < height - 1; y++) {
-		for (x = 1; x < width - 1; x++) {
+	vc_labelling_free(ws);
+	return blobs;
+}
 
-			posA = (y - 1) * width + (x - 1); 
-			posB = (y - 1) * width + x;       
-			posC = (y - 1) * width + (x + 1); 
-			posD = y * width + (x - 1);       
-			posX = y * width + x;             
-
-			if (datadst_int[posX] != 0) {
-				if ((datadst_int[posA] == 0) && (datadst_int[posB] == 0) &&
-					(datadst_int[posC] == 0) && (datadst_int[posD] == 0)) {
-					datadst_int[posX] = label;
-					labeltable[label] = label;
-					label++;
 
-					if (label >= width * height) {
-						free(datadst_int);
-						free(labeltable);
-						free(labelarea);
-						free(labelperimeter);
-						return NULL;
-					}
-				}
-				else {
-					num = 65535; 
-
-					// Se A está marcado
-					if (datadst_int[posA] != 0) num = labeltable[datadst_int[posA]];
-					// Se B está marcado, e é menor que a etiqueta "num"
-					if ((datadst_int[posB] != 0) && (labeltable[datadst_int[posB]] < num))
-						num = labeltable[datadst_int[posB]];
-					// Se C está marcado, e é menor que a etiqueta "num"
-					if ((datadst_int[posC] != 0) && (labeltable[datadst_int[posC]] < num))
-						num = labeltable[datadst_int[posC]];
-					// Se D está marcado, e é menor que a etiqueta "num"
-					if ((datadst_int[posD] != 0) && (labeltable[datadst_int[posD]] < num))
-						num = labeltable[datadst_int[posD]];
-
-					datadst_int[posX] = num;
-					labeltable[num] = num;
-
-					if (datadst_int[posA] != 0) {
-						if (labeltable[datadst_int[posA]] != num) {
-							for (tmplabel = labeltable[datadst_int[posA]], a = 1; a < label; a++) {
-								if (labeltable[a] == tmplabel) {
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst_int[posB] != 0) {
-						if (labeltable[datadst_int[posB]] != num) {
-							for (tmplabel = labeltable[datadst_int[posB]], a = 1; a < label; a++) {
-								if (labeltable[a] == tmplabel) {
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst_int[posC] != 0) {
-						if (labeltable[datadst_int[posC]] != num) {
-							for (tmplabel = labeltable[datadst_int[posC]], a = 1; a < label; a++) {
-								if (labeltable[a] == tmplabel) {
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst_int[posD] != 0) {
-						if (labeltable[datadst_int[posD]] != num) {
-							for (tmplabel = labeltable[datadst_int[posD]], a = 1; a < label; a++) {
-								if (labeltable[a] == tmplabel) {
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-	}
+// Centro de massa, momentos centrais de 2ª ordem e cor média de um blob, a partir das somas
+// sum: x, y, x^2, y^2, xy e (se channels > 0) a soma de cada canal da cor
+static void vc_blob_moments(OVC* blob, const long long* sum, int channels)
+{
+	double area = (double)MAX(blob->area, 1);
+	double cx, cy;
+	int c;
 
-	for (y = 1; y < height - 1; y++) {
-		for (x = 1; x < width - 1; x++) {
-			posX = y * width + x; // X
-
-			if (datadst_int[posX] != 0) {
-				datadst_int[posX] = labeltable[datadst_int[posX]];
-				labelarea[datadst_int[posX]]++;
-
-				int neighbors[4] = {
-					(y > 0) ? datadst_int[(y - 1) * width + x] : 0,         
-					(y < height - 1) ? datadst_int[(y + 1) * width + x] : 0,    
-					(x > 0) ? datadst_int[y * width + (x - 1)] : 0,           
-					(x < width - 1) ? datadst_int[y * width + (x + 1)] : 0      
-				};
-
-				for (int neighbor = 0; neighbor < 4; neighbor++) {
-					if (neighbors[neighbor] == 0) {
-						labelperimeter[datadst_int[posX]]++;
-						break;
-					}
-				}
-			}
-		}
-	}
+	blob->xc = (int)(sum[0] / MAX(blob->area, 1));
+	blob->yc = (int)(sum[1] / MAX(blob->area, 1));
 
-	for (a = 1; a < label - 1; a++) {
-		for (b = a + 1; b < label; b++) {
-			if (labeltable[a] == labeltable[b]) labeltable[b] = 0;
-		}
-	}
+	cx = (double)sum[0] / area;
+	cy = (double)sum[1] / area;
 
-	*nlabels = 0;
-	for (a = 1; a < label; a++) {
-		if (labeltable[a] != 0) {
-			labeltable[*nlabels] = labeltable[a]; 
-			labelarea[*nlabels] = labelarea[labeltable[a]]; 
-			labelperimeter[*nlabels] = labelperimeter[labeltable[a]]; 
-			(*nlabels)++; 
-		}
-	}
+	blob->cx = (float)cx;
+	blob->cy = (float)cy;
+	blob->mu20 = (float)((double)sum[2] / area - cx * cx);
+	blob->mu02 = (float)((double)sum[3] / area - cy * cy);
+	blob->mu11 = (float)((double)sum[4] / area - cx * cy);
 
-	if (*nlabels == 0) {
-		free(datadst_int);
-		free(labeltable);
-		free(labelarea);
-		free(labelperimeter);
-		return NULL;
+	for (c = 0; c < 3; c++) {
+		blob->meancolour[c] = (channels == 3) ? (float)((double)sum[5 + c] / area) : (channels == 1) ? (float)((double)sum[5] / area) : 0.0f;
 	}
+}
 
-	blobs = (OVC*)calloc((*nlabels), sizeof(OVC));
-	if (blobs != NULL) {
-		for (a = 0; a < (*nlabels); a++) {
-			blobs[a].label = labeltable[a];
-			blobs[a].area = labelarea[a];
-			blobs[a].perimeter = labelperimeter[a]; 
-
-			blobs[a].x = width;
-			blobs[a].y = height;
-			blobs[a].width = 0;
-			blobs[a].height = 0;
-		}
-	}
-	else {
-		free(datadst_int);
-		free(labeltable);
-		free(labelarea);
-		free(labelperimeter);
-		return NULL;
-	}
 
-	for (y = 1; y < height - 1; y++) {
-		for (x = 1; x < width - 1; x++) {
-			posX = y * width + x;
+// Raiz da classe de uma etiqueta, com compressão do caminho
+static int vc_label_find(int* parent, int a)
+{
+	int root = a, next;
 
-			if (datadst_int[posX] != 0) {
+	while (parent[root] != root) root = parent[root];
 
-				for (a = 0; a < *nlabels; a++) {
-					if (labeltable[a] == datadst_int[posX]) {
-						if (x < blobs[a].x) blobs[a].x = x;
-						if (y < blobs[a].y) blobs[a].y = y;
-						if (x > blobs[a].width) blobs[a].width = x;
-						if (y > blobs[a].height) blobs[a].height = y;
-						break;
-					}
+	while (parent[a] != root)
+	{
+		next = parent[a];
+		parent[a] = root;
+		a = next;
+	}
+
+	return root;
+}
+
+// Juntar as classes de a e b; a raiz é sempre a menor etiqueta (como na tabela de equivalências original)
+static int vc_label_union(int* parent, int a, int b)
+{
+	a = vc_label_find(parent, a);
+	b = vc_label_find(parent, b);
+
+	if (a < b)
+	{
+		parent[b] = a;
+		return a;
+	}
+
+	parent[a] = b;
+	return b;
+}
+
+
+// Etiquetagem de blobs com espaço de trabalho persistente
+// colour	: Opcional (NULL); imagem (1 ou 3 canais) com as mesmas dimensões, para a cor média de cada blob
+// dst		: Opcional (NULL); recebe a máscara 0/255 dos blobs (o mapa de etiquetas fica sempre no workspace)
+// ws		: Workspace criado com vc_labelling_new() para as mesmas dimensões de src
+// OVC*		: Array de blobs pertencente ao workspace, válido até à próxima chamada
+// Union-find em duas passagens (árvore de decisão de Wu/SAUF, vizinhança-8), em tempo linear.
+// Dá o mesmo resultado da versão original: etiquetas provisórias criadas nos mesmos pixels, cada blob
+// identificado pela menor etiqueta da sua classe e os blobs ordenados por essa etiqueta.
+// As linhas e colunas da margem da imagem não são etiquetadas.
+OVC* vc_binary_blob_labelling3(IVC* src, IVC* dst, IVC* colour, int* nlabels, LVC* ws)
+{
+	return vc_binary_blob_labelling_strips(src, dst, colour, nlabels, ws, 1, NULL, NULL);
+}
+
+
+// Estado de uma etiquetagem por faixas, partilhado pelas tarefas de cada faixa
+typedef struct {
+	IVC* src;
+	IVC* dst;
+	IVC* colour;
+	LVC* ws;
+	int nblobs;
+	int error;
+} VCLABELJOB;
+
+// Faixa s: linhas [y0, y1), etiquetas provisórias a partir de base
+#define VC_STRIP_Y0(ws, s)		((ws)->strips[(s) * 4 + 0])
+#define VC_STRIP_Y1(ws, s)		((ws)->strips[(s) * 4 + 1])
+#define VC_STRIP_BASE(ws, s)	((ws)->strips[(s) * 4 + 2])
+#define VC_STRIP_COUNT(ws, s)	((ws)->strips[(s) * 4 + 3])
+
+// 1ª passagem de uma faixa: etiquetas provisórias e equivalências (labeltable = pai de cada etiqueta)
+// Máscara: A B C (linha anterior) e D (à esquerda) do pixel X. A primeira linha da faixa é tratada como
+// se a linha anterior fosse fundo (usa-se a linha 0 do mapa, que está a zeros); a ligação às faixas
+// anteriores é feita depois, em série. Cada faixa só mexe nas suas etiquetas da tabela.
+static void vc_label_strip_pass1(void* arg, int strip)
+{
+	VCLABELJOB* job = (VCLABELJOB*)arg;
+	LVC* ws = job->ws;
+	unsigned char* datasrc = job->src->data;
+	int bytesperline = job->src->bytesperline;
+	int width = ws->width;
+	int* labeltable = ws->labeltable;
+	int y0 = VC_STRIP_Y0(ws, strip);
+	int y1 = VC_STRIP_Y1(ws, strip);
+	int label = VC_STRIP_BASE(ws, strip);
+	int last = (strip + 1 < ws->nstrips) ? VC_STRIP_BASE(ws, strip + 1) : ws->maxlabels;
+	unsigned int *row, *prev;
+	unsigned char* s;
+	int x, y;
+
+	for (y = y0; y < y1; y++) {
+		row = &ws->labels[y * width];
+		prev = (y == y0) ? ws->labels : row - width;
+		s = &datasrc[y * bytesperline];
+
+		row[0] = 0;
+		row[width - 1] = 0;
+
+		for (x = 1; x < width - 1; x++) {
+			if (s[x] == 0) {
+				row[x] = 0;
+			}
+			else if (prev[x] != 0) {
+				// B é vizinho de A, C e D: já estão todos na mesma classe
+				row[x] = prev[x];
+			}
+			else if (prev[x + 1] != 0) {
+				// C não é vizinho de A nem de D
+				row[x] = prev[x + 1];
+				if (prev[x - 1] != 0) vc_label_union(labeltable, prev[x + 1], prev[x - 1]);
+				else if (row[x - 1] != 0) vc_label_union(labeltable, prev[x + 1], row[x - 1]);
+			}
+			else if (prev[x - 1] != 0) {
+				row[x] = prev[x - 1];
+			}
+			else if (row[x - 1] != 0) {
+				row[x] = row[x - 1];
+			}
+			else {
+				if (label >= last) {
+					job->error = 1;
+					VC_STRIP_COUNT(ws, strip) = 0;
+					return;
+				}
+
+				row[x] = label;
+				labeltable[label] = label;
+				label++;
+			}
+		}
+	}
+
+	VC_STRIP_COUNT(ws, strip) = label - VC_STRIP_BASE(ws, strip);
+}
+
+// 2ª passagem de uma faixa: estatísticas parciais de cada blob (área, perímetro, caixa delimitadora,
+// momentos e soma da cor), acedidas diretamente pelo índice do blob. O mapa só é lido, por isso as
+// faixas podem ler as linhas vizinhas umas das outras
+static void vc_label_strip_pass2(void* arg, int strip)
+{
+	VCLABELJOB* job = (VCLABELJOB*)arg;
+	LVC* ws = job->ws;
+	IVC* colour = job->colour;
+	int width = ws->width;
+	int* labeltable = ws->labeltable;
+	int colourchannels = (colour != NULL) ? colour->channels : 0;
+	OVC* blobs = (ws->nstrips > 1) ? &ws->partial[strip * job->nblobs] : ws->blobs;
+	long long* sums = (ws->nstrips > 1) ? &ws->partialsums[(long int)strip * job->nblobs * VC_BLOB_SUMS] : ws->sums;
+	unsigned int *row, *prev, *next;
+	unsigned char* pc;
+	OVC* blob;
+	long long* sum;
+	int x, y, a, c;
+
+	for (a = 0; a < job->nblobs; a++) {
+		blobs[a].x = width;
+		blobs[a].y = ws->height;
+		blobs[a].width = 0;
+		blobs[a].height = 0;
+		blobs[a].area = 0;
+		blobs[a].perimeter = 0;
+	}
+	memset(sums, 0, job->nblobs * VC_BLOB_SUMS * sizeof(long long));
+
+	for (y = VC_STRIP_Y0(ws, strip); y < VC_STRIP_Y1(ws, strip); y++) {
+		row = &ws->labels[y * width];
+		prev = row - width;
+		next = row + width;
+		pc = (colour != NULL) ? &colour->data[y * colour->bytesperline] : NULL;
+
+		for (x = 1; x < width - 1; x++) {
+			if (row[x] != 0) {
+				a = labeltable[row[x]];
+				blob = &blobs[a];
+				sum = &sums[a * VC_BLOB_SUMS];
+
+				blob->area++;
+				if ((prev[x] == 0) || (next[x] == 0) || (row[x - 1] == 0) || (row[x + 1] == 0)) blob->perimeter++;
+
+				if (x < blob->x) blob->x = x;
+				if (y < blob->y) blob->y = y;
+				if (x > blob->width) blob->width = x;
+				if (y > blob->height) blob->height = y;
+
+				sum[0] += x;
+				sum[1] += y;
+				sum[2] += (long long)x * x;
+				sum[3] += (long long)y * y;
+				sum[4] += (long long)x * y;
+
+				if (pc != NULL) {
+					for (c = 0; c < colourchannels; c++) sum[5 + c] += pc[x * colourchannels + c];
 				}
 			}
 		}
 	}
+}
+
+#if VC_BLOB_REGION_SUMS > VC_BLOB_SUMS
+#error "A 3ª passagem guarda as somas da cor por regiões nos arrays das somas da 2ª passagem"
+#endif
+
+// 3ª passagem de uma faixa: etiqueta final (a do blob) no mapa e máscara 0/255 em dst
+// Com imagem de cor, soma também a cor do disco interior e do anel exterior de cada blob (o centro já
+// é conhecido), nos arrays de somas da 2ª passagem, que já não são precisos
+static void vc_label_strip_pass3(void* arg, int strip)
+{
+	VCLABELJOB* job = (VCLABELJOB*)arg;
+	LVC* ws = job->ws;
+	IVC* dst = job->dst;
+	IVC* colour = job->colour;
+	int width = ws->width;
+	int* labeltable = ws->labeltable;
+	int channels = (colour != NULL) ? colour->channels : 0;
+	long long* sums = (ws->nstrips > 1) ? &ws->partialsums[(long int)strip * job->nblobs * VC_BLOB_SUMS] : ws->sums;
+	unsigned int* row;
+	unsigned char *s, *pc;
+	long long* sum;
+	OVC* blob;
+	float dx, dy, d2, r2;
+	int x, y, y0, y1, a, c;
+
+	// A primeira faixa trata também a linha 0 e a última a linha height - 1 (fundo)
+	y0 = (strip == 0) ? 0 : VC_STRIP_Y0(ws, strip);
+	y1 = (strip == ws->nstrips - 1) ? ws->height : VC_STRIP_Y1(ws, strip);
+
+	if (colour != NULL) memset(sums, 0, job->nblobs * VC_BLOB_SUMS * sizeof(long long));
+
+	for (y = y0; y < y1; y++) {
+		row = &ws->labels[y * width];
+
+		if (colour == NULL) {
+			for (x = 0; x < width; x++) {
+				if (row[x] != 0) row[x] = (unsigned int)ws->blobs[labeltable[row[x]]].label;
+			}
+		}
+		else {
+			pc = &colour->data[y * colour->bytesperline];
+
+			for (x = 0; x < width; x++) {
+				if (row[x] == 0) continue;
+
+				a = labeltable[row[x]];
+				blob = &ws->blobs[a];
+				row[x] = (unsigned int)blob->label;
+
+				// Distância^2 ao centro comparada com o raio^2 do círculo com a área do blob
+				dx = (float)x - blob->cx;
+				dy = (float)y - blob->cy;
+				d2 = dx * dx + dy * dy;
+				r2 = (float)blob->area * (1.0f / 3.14159265f);
+
+				if (d2 < VC_BLOB_INNER_RADIUS * VC_BLOB_INNER_RADIUS * r2) sum = &sums[a * VC_BLOB_SUMS];
+				else if (d2 >= VC_BLOB_OUTER_RADIUS * VC_BLOB_OUTER_RADIUS * r2) sum = &sums[a * VC_BLOB_SUMS + 4];
+				else continue;
+
+				for (c = 0; c < 3; c++) sum[c] += pc[x * channels + ((channels == 3) ? c : 0)];
+				sum[3]++;
+			}
+		}
+
+		if (dst != NULL) {
+			s = &dst->data[y * dst->bytesperline];
+			for (x = 0; x < width; x++) s[x] = (row[x] != 0) ? 255 : 0;
+		}
+	}
+}
+
+// Executa task(arg, 0 .. n - 1), em paralelo se houver um executor
+static void vc_label_run(VCPARALLEL parallel, void* pool, int n, VCTASK task, void* arg)
+{
+	int i;
+
+	if ((parallel != NULL) && (n > 1)) {
+		parallel(pool, n, task, arg);
+	}
+	else {
+		for (i = 0; i < n; i++) task(arg, i);
+	}
+}
+
+// Divide as linhas 1 .. height - 2 em nstrips faixas e reserva as etiquetas e as somas parciais
+static int vc_label_strips_reserve(LVC* ws, int nstrips)
+{
+	int s, y0, y1, rows, base;
+	long int needed;
+	int* strips;
+	int* labeltable;
+
+	if (nstrips > ws->height - 2) nstrips = ws->height - 2;
+	if (nstrips < 1) nstrips = 1;
+
+	if (nstrips > ws->maxstrips) {
+		strips = (int*)realloc(ws->strips, nstrips * 4 * sizeof(int));
+		if (strips == NULL) return 0;
+		ws->strips = strips;
+		ws->maxstrips = nstrips;
+	}
+	ws->nstrips = nstrips;
+
+	// Cada faixa tem o seu intervalo de etiquetas (no máximo uma nova por bloco 2x2 da faixa),
+	// por ordem das faixas: a etiqueta continua a crescer pela ordem de varrimento da imagem
+	base = 1;
+	rows = ws->height - 2;
+	for (s = 0; s < nstrips; s++) {
+		y0 = 1 + (int)((long int)rows * s / nstrips);
+		y1 = 1 + (int)((long int)rows * (s + 1) / nstrips);
+
+		VC_STRIP_Y0(ws, s) = y0;
+		VC_STRIP_Y1(ws, s) = y1;
+		VC_STRIP_BASE(ws, s) = base;
+		VC_STRIP_COUNT(ws, s) = 0;
+
+		base += ((ws->width + 1) / 2) * ((y1 - y0 + 1) / 2);
+	}
+
+	needed = MAX(base, ws->maxlabels);
+	if (needed > ws->maxlabels) {
+		labeltable = (int*)realloc(ws->labeltable, needed * sizeof(int));
+		if (labeltable == NULL) return 0;
+		ws->labeltable = labeltable;
+		ws->maxlabels = (int)needed;
+	}
+
+	return 1;
+}
+
+
+// Etiquetagem de blobs por faixas horizontais, em paralelo
+// nstrips	: Número de faixas (1 = vc_binary_blob_labelling3)
+// parallel	: Executor das tarefas (NULL = em série), chamado com pool; as tarefas de cada chamada são
+//			  independentes e o executor só retorna quando todas terminarem
+// Cada faixa é etiquetada independentemente; depois, em série, juntam-se as classes que atravessam as
+// fronteiras entre faixas. A ordem dos blobs e todas as características são iguais às da etiquetagem
+// numa só faixa; só os valores das etiquetas (OVC.label) podem ser diferentes, por começarem em cada faixa.
+OVC* vc_binary_blob_labelling_strips(IVC* src, IVC* dst, IVC* colour, int* nlabels, LVC* ws, int nstrips, VCPARALLEL parallel, void* pool)
+{
+	int width = src->width;
+	int height = src->height;
+	int x, y, a, s, i;
+	int* labeltable;
+	unsigned int *row, *prev;
+	OVC* blobs;
+	OVC* blob;
+	OVC* part;
+	long long* sums;
+	long long* partsums;
+	VCLABELJOB job;
+
+	*nlabels = 0;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return NULL;
+	if ((dst != NULL) && ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels))) return NULL;
+	if (src->channels != 1) return NULL;
+	if ((ws == NULL) || (ws->width != width) || (ws->height != height)) return NULL;
+	ws->nblobs = -1;
+	if (colour != NULL) {
+		if ((colour->width != width) || (colour->height != height) || (colour->data == NULL)) return NULL;
+		if ((colour->channels != 1) && (colour->channels != 3)) return NULL;
+	}
+
+	job.src = src;
+	job.dst = dst;
+	job.colour = colour;
+	job.ws = ws;
+	job.nblobs = 0;
+	job.error = 0;
+
+	// Linhas da margem a zero (a linha 0 serve também de "linha anterior" à primeira linha de cada faixa)
+	memset(ws->labels, 0, width * sizeof(unsigned int));
+	if (height > 1) memset(&ws->labels[(height - 1) * width], 0, width * sizeof(unsigned int));
+
+	if (height < 3) {
+		for (y = 0; (dst != NULL) && (y < height); y++) memset(&dst->data[y * dst->bytesperline], 0, width);
+		ws->nblobs = 0;
+		return NULL;
+	}
+
+	if (!vc_label_strips_reserve(ws, nstrips)) return NULL;
+
+	labeltable = ws->labeltable;
+	labeltable[0] = 0;
+
+	vc_label_run(parallel, pool, ws->nstrips, vc_label_strip_pass1, &job);
+	if (job.error) return NULL;
+
+	// Fronteiras entre faixas: cada pixel da primeira linha de uma faixa junta-se aos vizinhos de cima
+	for (s = 1; s < ws->nstrips; s++) {
+		row = &ws->labels[VC_STRIP_Y0(ws, s) * width];
+		prev = row - width;
+
+		for (x = 1; x < width - 1; x++) {
+			if (row[x] == 0) continue;
+
+			if (prev[x] != 0) {
+				vc_label_union(labeltable, row[x], prev[x]);
+			}
+			else {
+				if (prev[x - 1] != 0) vc_label_union(labeltable, row[x], prev[x - 1]);
+				if (prev[x + 1] != 0) vc_label_union(labeltable, row[x], prev[x + 1]);
+			}
+		}
+	}
+
+	// Etiquetas finais: a raiz de cada classe é a menor etiqueta, logo labeltable[l] <= l e basta uma passagem
+	// crescente. As raízes, por ordem, são os blobs; labeltable passa a guardar o índice do blob de cada etiqueta
+	for (s = 0; s < ws->nstrips; s++) {
+		for (a = VC_STRIP_BASE(ws, s); a < VC_STRIP_BASE(ws, s) + VC_STRIP_COUNT(ws, s); a++) {
+			if (labeltable[a] == a) {
+				(*nlabels)++;
+			}
+		}
+	}
+
+	if (*nlabels == 0) {
+		for (y = 0; (dst != NULL) && (y < height); y++) memset(&dst->data[y * dst->bytesperline], 0, width);
+		ws->nblobs = 0;
+		return NULL;
+	}
+
+	// Os arrays de blobs (e das somas) só crescem; em regime estacionário não há alocações
+	if (*nlabels > ws->maxblobs) {
+		blobs = (OVC*)realloc(ws->blobs, (*nlabels) * sizeof(OVC));
+		if (blobs != NULL) ws->blobs = blobs;
+		sums = (long long*)realloc(ws->sums, (*nlabels) * VC_BLOB_SUMS * sizeof(long long));
+		if (sums != NULL) ws->sums = sums;
+		if ((blobs == NULL) || (sums == NULL)) {
+			*nlabels = 0;
+			return NULL;
+		}
+		ws->maxblobs = *nlabels;
+	}
+	if ((ws->nstrips > 1) && ((long int)ws->nstrips * (*nlabels) > ws->maxpartial)) {
+		part = (OVC*)realloc(ws->partial, (long int)ws->nstrips * (*nlabels) * sizeof(OVC));
+		if (part != NULL) ws->partial = part;
+		partsums = (long long*)realloc(ws->partialsums, (long int)ws->nstrips * (*nlabels) * VC_BLOB_SUMS * sizeof(long long));
+		if (partsums != NULL) ws->partialsums = partsums;
+		if ((part == NULL) || (partsums == NULL)) {
+			*nlabels = 0;
+			return NULL;
+		}
+		ws->maxpartial = ws->nstrips * (*nlabels);
+	}
+	blobs = ws->blobs;
+	sums = ws->sums;
+	memset(blobs, 0, (*nlabels) * sizeof(OVC));
+
+	for (s = 0, *nlabels = 0; s < ws->nstrips; s++) {
+		for (a = VC_STRIP_BASE(ws, s); a < VC_STRIP_BASE(ws, s) + VC_STRIP_COUNT(ws, s); a++) {
+			if (labeltable[a] == a) {
+				blobs[*nlabels].label = a;
+				labeltable[a] = (*nlabels)++;
+			}
+			else {
+				labeltable[a] = labeltable[labeltable[a]];
+			}
+		}
+	}
+	job.nblobs = *nlabels;
+
+	vc_label_run(parallel, pool, ws->nstrips, vc_label_strip_pass2, &job);
+
+	// Junta as estatísticas parciais das faixas (somas inteiras: o resultado não depende das faixas)
+	if (ws->nstrips > 1) {
+		for (a = 0; a < *nlabels; a++) {
+			blob = &blobs[a];
+			blob->x = width;
+			blob->y = height;
+			memset(&sums[a * VC_BLOB_SUMS], 0, VC_BLOB_SUMS * sizeof(long long));
+
+			for (s = 0; s < ws->nstrips; s++) {
+				part = &ws->partial[s * (*nlabels) + a];
+				partsums = &ws->partialsums[((long int)s * (*nlabels) + a) * VC_BLOB_SUMS];
+
+				if (part->area == 0) continue;
+
+				blob->area += part->area;
+				blob->perimeter += part->perimeter;
+				if (part->x < blob->x) blob->x = part->x;
+				if (part->y < blob->y) blob->y = part->y;
+				if (part->width > blob->width) blob->width = part->width;
+				if (part->height > blob->height) blob->height = part->height;
+
+				for (i = 0; i < VC_BLOB_SUMS; i++) sums[a * VC_BLOB_SUMS + i] += partsums[i];
+			}
+		}
+	}
 
 	for (a = 0; a < *nlabels; a++) {
 		blobs[a].width = blobs[a].width - blobs[a].x + 1;
 		blobs[a].height = blobs[a].height - blobs[a].y + 1;
+
+		vc_blob_moments(&blobs[a], &sums[a * VC_BLOB_SUMS], (colour != NULL) ? colour->channels : 0);
 	}
 
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			if (datadst_int[y * width + x] > 0) {
-				datadst[y * bytesperline + x * channels] = 255;
+	vc_label_run(parallel, pool, ws->nstrips, vc_label_strip_pass3, &job);
+
+	// Cor do disco interior e do anel exterior (juntando as somas das faixas)
+	if (colour != NULL) {
+		for (a = 0; a < *nlabels; a++) {
+			long long region[VC_BLOB_REGION_SUMS];
+
+			if (ws->nstrips > 1) {
+				memset(region, 0, sizeof(region));
+				for (s = 0; s < ws->nstrips; s++) {
+					partsums = &ws->partialsums[((long int)s * (*nlabels) + a) * VC_BLOB_SUMS];
+					for (i = 0; i < VC_BLOB_REGION_SUMS; i++) region[i] += partsums[i];
+				}
 			}
 			else {
-				datadst[y * bytesperline + x * channels] = 0;
+				memcpy(region, &sums[a * VC_BLOB_SUMS], sizeof(region));
+			}
+
+			blobs[a].innerarea = (int)region[3];
+			blobs[a].outerarea = (int)region[7];
+			for (i = 0; i < 3; i++) {
+				blobs[a].innercolour[i] = (region[3] > 0) ? (float)((double)region[i] / region[3]) : 0.0f;
+				blobs[a].outercolour[i] = (region[7] > 0) ? (float)((double)region[4 + i] / region[7]) : 0.0f;
 			}
 		}
 	}
 
-	free(datadst_int);
-	free(labeltable);
-	free(labelarea);
-	free(labelperimeter);
+	ws->nblobs = *nlabels;
+
 	return blobs;
 }
 
 
+// Mapa de etiquetas da última etiquetagem (width * height inteiros, sem padding)
+// 0 = fundo; nos blobs, a etiqueta do blob (OVC.label). NULL se a última etiquetagem falhou
+const unsigned int* vc_labelling_labels(const LVC* ws)
+{
+	if ((ws == NULL) || (ws->nblobs < 0)) return NULL;
+
+	return ws->labels;
+}
+
+
+// Índice (no array de blobs) do blob com uma dada etiqueta do mapa, ou -1 (fundo ou etiqueta inválida)
+int vc_labelling_index(const LVC* ws, unsigned int label)
+{
+	if ((ws == NULL) || (ws->nblobs <= 0) || (label == 0) || (label >= (unsigned int)ws->maxlabels)) return -1;
+
+	// Depois da etiquetagem, labeltable guarda o índice do blob de cada etiqueta provisória (incluindo as raízes)
+	return ws->labeltable[label];
+}
+
+
+// Copiar o mapa de etiquetas para um buffer do chamador
+// dst		: width * height inteiros, com stride (em elementos, >= width) entre linhas
+// index	: 0 = escreve a etiqueta (OVC.label); 1 = escreve o índice do blob + 1 (1..nblobs)
+int vc_labelling_map(const LVC* ws, unsigned int* dst, int stride, int index)
+{
+	const unsigned int* row;
+	unsigned int* out;
+	int x, y;
+
+	if ((ws == NULL) || (ws->nblobs < 0) || (dst == NULL) || (stride < ws->width)) return 0;
+
+	for (y = 0; y < ws->height; y++) {
+		row = &ws->labels[y * ws->width];
+		out = &dst[(long int)y * stride];
+
+		if (!index) {
+			memcpy(out, row, ws->width * sizeof(unsigned int));
+		}
+		else {
+			for (x = 0; x < ws->width; x++) {
+				out[x] = (row[x] != 0) ? (unsigned int)(ws->labeltable[row[x]] + 1) : 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+
+// Máscara 0/255 de um só blob da última etiquetagem (para amostrar a cor, recortar ou seguir o contorno)
+// Só a caixa delimitadora do blob é percorrida no mapa; o resto de dst fica a 0
+int vc_labelling_blob_mask(const LVC* ws, const OVC* blob, IVC* dst)
+{
+	const unsigned int* row;
+	unsigned char* out;
+	unsigned int label;
+	int x, y;
+
+	if ((ws == NULL) || (ws->nblobs <= 0) || (blob == NULL) || (dst == NULL) || (dst->data == NULL)) return 0;
+	if ((dst->width != ws->width) || (dst->height != ws->height) || (dst->channels != 1)) return 0;
+
+	label = (unsigned int)blob->label;
+
+	for (y = 0; y < dst->height; y++) memset(&dst->data[y * dst->bytesperline], 0, dst->width);
+
+	for (y = blob->y; y < blob->y + blob->height; y++) {
+		row = &ws->labels[y * ws->width];
+		out = &dst->data[y * dst->bytesperline];
+
+		for (x = blob->x; x < blob->x + blob->width; x++) {
+			if (row[x] == label) out[x] = 255;
+		}
+	}
+
+	return 1;
+}
+
+
+// Informação dos blobs a partir de uma imagem de etiquetas de 8 bits (vc_binary_blob_labelling)
+// Uma só passagem pela imagem: cada pixel é associado ao seu blob por uma tabela etiqueta -> índice
 int vc_binary_blob_info(IVC* src, OVC* blobs, int nblobs)
 {
 	unsigned char* data = (unsigned char*)src->data;
@@ -1375,59 +2527,98 @@ int vc_binary_blob_info(IVC* src, OVC* blobs, int nblobs)
 	int channels = src->channels;
 	int x, y, i;
 	long int pos;
-	int xmin, ymin, xmax, ymax;
-	long int sumx, sumy;
+	unsigned char v;
+	int index[256];
+	long long* sums;
+	long long* sum;
+	int* bbox;					// xmin, ymin, xmax, ymax e pixels de contorno de cada blob
 
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
 	if (channels != 1) return 0;
+	if (nblobs <= 0) return 1;
 
-	for (i = 0; i < nblobs; i++)
+	sums = (long long*)calloc(nblobs * VC_BLOB_SUMS, sizeof(long long));
+	bbox = (int*)malloc(nblobs * 5 * sizeof(int));
+	if ((sums == NULL) || (bbox == NULL))
 	{
-		xmin = width - 1;
-		ymin = height - 1;
-		xmax = 0;
-		ymax = 0;
+		free(sums);
+		free(bbox);
+		return 0;
+	}
 
-		sumx = 0;
-		sumy = 0;
+	// Só etiquetas 1..255 podem aparecer numa imagem de 8 bits; havendo blobs repetidos, conta o primeiro
+	for (i = 0; i < 256; i++) index[i] = -1;
+	for (i = nblobs - 1; i >= 0; i--)
+	{
+		if ((blobs[i].label > 0) && (blobs[i].label < 256)) index[blobs[i].label] = i;
+	}
 
+	for (i = 0; i < nblobs; i++)
+	{
+		bbox[i * 5 + 0] = width - 1;
+		bbox[i * 5 + 1] = height - 1;
+		bbox[i * 5 + 2] = 0;
+		bbox[i * 5 + 3] = 0;
+		bbox[i * 5 + 4] = 0;
 		blobs[i].area = 0;
+	}
 
-		for (y = 1; y < height - 1; y++)
+	for (y = 1; y < height - 1; y++)
+	{
+		for (x = 1; x < width - 1; x++)
 		{
-			for (x = 1; x < width - 1; x++)
-			{
-				pos = y * bytesperline + x * channels;
+			pos = y * bytesperline + x * channels;
+			v = data[pos];
 
-				if (data[pos] == blobs[i].label)
-				{
-					blobs[i].area++;
+			if ((v == 0) || (index[v] < 0)) continue;
 
-					sumx += x;
-					sumy += y;
+			i = index[v];
+			sum = &sums[i * VC_BLOB_SUMS];
 
-					if (xmin > x) xmin = x;
-					if (ymin > y) ymin = y;
-					if (xmax < x) xmax = x;
-					if (ymax < y) ymax = y;
+			blobs[i].area++;
 
-					if ((data[pos - 1] != blobs[i].label) || (data[pos + 1] != blobs[i].label) || (data[pos - bytesperline] != blobs[i].label) || (data[pos + bytesperline] != blobs[i].label))
-					{
-						blobs[i].perimeter++;
-					}
-				}
+			sum[0] += x;
+			sum[1] += y;
+			sum[2] += (long long)x * x;
+			sum[3] += (long long)y * y;
+			sum[4] += (long long)x * y;
+
+			if (bbox[i * 5 + 0] > x) bbox[i * 5 + 0] = x;
+			if (bbox[i * 5 + 1] > y) bbox[i * 5 + 1] = y;
+			if (bbox[i * 5 + 2] < x) bbox[i * 5 + 2] = x;
+			if (bbox[i * 5 + 3] < y) bbox[i * 5 + 3] = y;
+
+			if ((data[pos - 1] != v) || (data[pos + 1] != v) || (data[pos - bytesperline] != v) || (data[pos + bytesperline] != v))
+			{
+				bbox[i * 5 + 4]++;
 			}
 		}
+	}
+
+	for (i = 0; i < nblobs; i++)
+	{
+		// Blobs com a mesma etiqueta recebem os valores do primeiro
+		if ((blobs[i].label > 0) && (blobs[i].label < 256) && (index[blobs[i].label] != i))
+		{
+			int first = index[blobs[i].label];
+
+			memcpy(&bbox[i * 5], &bbox[first * 5], 5 * sizeof(int));
+			memcpy(&sums[i * VC_BLOB_SUMS], &sums[first * VC_BLOB_SUMS], VC_BLOB_SUMS * sizeof(long long));
+			blobs[i].area = blobs[first].area;
+		}
 
-		blobs[i].x = xmin;
-		blobs[i].y = ymin;
-		blobs[i].width = (xmax - xmin) + 1;
-		blobs[i].height = (ymax - ymin) + 1;
+		blobs[i].x = bbox[i * 5 + 0];
+		blobs[i].y = bbox[i * 5 + 1];
+		blobs[i].width = (bbox[i * 5 + 2] - bbox[i * 5 + 0]) + 1;
+		blobs[i].height = (bbox[i * 5 + 3] - bbox[i * 5 + 1]) + 1;
+		blobs[i].perimeter += bbox[i * 5 + 4];
 
-		blobs[i].xc = sumx / MAX(blobs[i].area, 1);
-		blobs[i].yc = sumy / MAX(blobs[i].area, 1);
+		vc_blob_moments(&blobs[i], &sums[i * VC_BLOB_SUMS], 0);
 	}
 
+	free(sums);
+	free(bbox);
+
 	return 1;
 }
 
@@ -1456,6 +2647,7 @@ int vc_join_segmentations(IVC* src1, IVC* src2, IVC* dst) {
 	int bytesperline2 = src2->bytesperline;
 	int bytesperlineOut = dst->bytesperline;
 	int channels = src1->channels;
+	const VCSIMD* simd = vc_simd();
 	int x, y;
 	long int pos1, pos2, posOut;
 
@@ -1470,7 +2662,9 @@ int vc_join_segmentations(IVC* src1, IVC* src2, IVC* dst) {
 	}
 
 	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
+		x = (simd->join != NULL) ? simd->join(&data1[y * bytesperline1], &data2[y * bytesperline2], &dataout[y * bytesperlineOut], width) : 0;
+
+		for (; x < width; x++) {
 			pos1 = y * bytesperline1 + x * channels;
 			pos2 = y * bytesperline2 + x * channels;
 			posOut = y * bytesperlineOut + x * channels;
@@ -1488,3 +2682,381 @@ int vc_join_segmentations(IVC* src1, IVC* src2, IVC* dst) {
 }
 
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        FUNÇÕES: MÁSCARAS BINÁRIAS COMPACTAS (1 BIT/PIXEL)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Bits de uma palavra que pertencem à imagem (a última palavra de cada linha pode ter bits a mais)
+static unsigned long long vc_packed_tail(int width)
+{
+	return ((width & 63) == 0) ? ~0ULL : ((1ULL << (width & 63)) - 1);
+}
+
+static int vc_popcount64(unsigned long long w)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Alocar uma máscara compacta (todos os pixels a 0)
+PVC *vc_packed_new(int width, int height)
+{
+	PVC *mask;
+
+	if ((width <= 0) || (height <= 0)) return NULL;
+
+	mask = (PVC *)malloc(sizeof(PVC));
+	if (mask == NULL) return NULL;
+
+	mask->width = width;
+	mask->height = height;
+	mask->wordsperline = (width + 63) / 64;
+	mask->data = (unsigned long long *)calloc((size_t)mask->wordsperline * height, sizeof(unsigned long long));
+
+	if (mask->data == NULL) return vc_packed_free(mask);
+
+	return mask;
+}
+
+PVC *vc_packed_free(PVC *mask)
+{
+	if (mask != NULL)
+	{
+		free(mask->data);
+		free(mask);
+	}
+
+	return NULL;
+}
+
+// Compactar uma imagem binária (1 canal): pixel != 0 -> bit a 1
+int vc_packed_from_binary(IVC* src, PVC* dst)
+{
+	const VCSIMD* simd = vc_simd();
+	unsigned char* p;
+	unsigned long long* row;
+	unsigned long long word;
+	int x, y, b;
+
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if (src->channels != 1) return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		p = &src->data[y * src->bytesperline];
+		row = &dst->data[y * dst->wordsperline];
+
+		x = (simd->pack != NULL) ? simd->pack(p, row, src->width) : 0;
+
+		for (; x < src->width; x += 64)
+		{
+			word = 0;
+			for (b = 0; (b < 64) && (x + b < src->width); b++)
+			{
+				word |= (unsigned long long)(p[x + b] != 0) << b;
+			}
+			row[x / 64] = word;
+		}
+	}
+
+	return 1;
+}
+
+// Expandir uma máscara compacta para imagem binária (0/255)
+int vc_packed_to_binary(PVC* src, IVC* dst)
+{
+	const VCSIMD* simd = vc_simd();
+	unsigned char* p;
+	unsigned long long* row;
+	int x, y;
+
+	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if (dst->channels != 1) return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		p = &dst->data[y * dst->bytesperline];
+		row = &src->data[y * src->wordsperline];
+
+		x = (simd->unpack != NULL) ? simd->unpack(row, p, src->width) : 0;
+
+		for (; x < src->width; x++)
+		{
+			p[x] = ((row[x / 64] >> (x & 63)) & 1) ? 255 : 0;
+		}
+	}
+
+	return 1;
+}
+
+// Palavra j de uma linha, complementada com flip e sem bits fora da imagem; fora da linha = 0
+static unsigned long long vc_packed_word(const unsigned long long* row, int n, int j, unsigned long long flip, unsigned long long tail)
+{
+	if ((j < 0) || (j >= n)) return 0;
+
+	return (j == n - 1) ? ((row[j] ^ flip) & tail) : (row[j] ^ flip);
+}
+
+// Palavra i de uma linha deslocada s pixels (s > 0: o pixel x recebe o pixel x - s)
+static unsigned long long vc_packed_shifted(const unsigned long long* row, int n, int i, int s, unsigned long long flip, unsigned long long tail)
+{
+	int q, r;
+
+	if (s >= 0)
+	{
+		q = i - (s >> 6);
+		r = s & 63;
+		if (r == 0) return vc_packed_word(row, n, q, flip, tail);
+		return (vc_packed_word(row, n, q, flip, tail) << r) | (vc_packed_word(row, n, q - 1, flip, tail) >> (64 - r));
+	}
+
+	s = -s;
+	q = i + (s >> 6);
+	r = s & 63;
+	if (r == 0) return vc_packed_word(row, n, q, flip, tail);
+	return (vc_packed_word(row, n, q, flip, tail) >> r) | (vc_packed_word(row, n, q + 1, flip, tail) << (64 - r));
+}
+
+// Dilatação horizontal (janela x - o .. x + o) de todas as linhas; invert complementa a entrada (para a erosão)
+static void vc_packed_rows(PVC* src, PVC* dst, int o, int invert)
+{
+	int n = src->wordsperline;
+	unsigned long long tail = vc_packed_tail(src->width);
+	unsigned long long flip = invert ? ~0ULL : 0;
+	unsigned long long* in;
+	unsigned long long* out;
+	unsigned long long acc;
+	int y, i, d;
+
+	for (y = 0; y < src->height; y++)
+	{
+		in = &src->data[y * n];
+		out = &dst->data[y * n];
+
+		for (i = 0; i < n; i++)
+		{
+			acc = vc_packed_word(in, n, i, flip, tail);
+			for (d = 1; d <= o; d++)
+			{
+				acc |= vc_packed_shifted(in, n, i, d, flip, tail) | vc_packed_shifted(in, n, i, -d, flip, tail);
+			}
+			out[i] = acc;
+		}
+		out[n - 1] &= tail;
+	}
+}
+
+// Dilatação vertical (linhas y - o .. y + o): OR de linhas inteiras, 64 pixels por operação
+static void vc_packed_cols(PVC* src, PVC* dst, int o, int invert)
+{
+	int n = src->wordsperline;
+	int height = src->height;
+	unsigned long long tail = vc_packed_tail(src->width);
+	unsigned long long flip = invert ? ~0ULL : 0;
+	unsigned long long* out;
+	unsigned long long* in;
+	int y, sy, i;
+
+	for (y = 0; y < height; y++)
+	{
+		out = &dst->data[y * n];
+
+		for (i = 0; i < n; i++) out[i] = 0;
+
+		for (sy = MAX(y - o, 0); (sy <= y + o) && (sy < height); sy++)
+		{
+			in = &src->data[sy * n];
+			for (i = 0; i < n; i++) out[i] |= in[i];
+		}
+
+		for (i = 0; i < n; i++) out[i] ^= flip;
+		out[n - 1] &= tail;
+	}
+}
+
+static int vc_packed_morph(PVC* src, PVC* dst, PVC* tmp, int kernel, int erode)
+{
+	int offset = kernel / 2;
+
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((tmp == NULL) || (tmp == src) || (tmp == dst)) return 0;
+	if ((tmp->width != src->width) || (tmp->height != src->height)) return 0;
+	if (offset < 0) offset = 0;
+
+	// Erosão = complemento da dilatação do complemento (fora da imagem conta como 0 nos dois casos)
+	vc_packed_rows(src, tmp, offset, erode);
+	vc_packed_cols(tmp, dst, offset, erode);
+
+	return 1;
+}
+
+// Dilatação e erosão com elemento quadrado kernel x kernel (mesmo resultado de vc_binary_dilate/erode
+// para máscaras 0/255); tmp é uma máscara auxiliar do mesmo tamanho, diferente de src e dst
+int vc_packed_dilate(PVC* src, PVC* dst, PVC* tmp, int kernel)
+{
+	return vc_packed_morph(src, dst, tmp, kernel, 0);
+}
+
+int vc_packed_erode(PVC* src, PVC* dst, PVC* tmp, int kernel)
+{
+	return vc_packed_morph(src, dst, tmp, kernel, 1);
+}
+
+// Abertura e fecho: dst pode ser a própria src
+int vc_packed_open(PVC* src, PVC* dst, PVC* tmp, int kernel)
+{
+	if (!vc_packed_erode(src, dst, tmp, kernel)) return 0;
+
+	return vc_packed_dilate(dst, dst, tmp, kernel);
+}
+
+int vc_packed_close(PVC* src, PVC* dst, PVC* tmp, int kernel)
+{
+	if (!vc_packed_dilate(src, dst, tmp, kernel)) return 0;
+
+	return vc_packed_erode(dst, dst, tmp, kernel);
+}
+
+// União de duas máscaras (equivalente a vc_join_segmentations)
+int vc_packed_join(PVC* src1, PVC* src2, PVC* dst)
+{
+	long int i, n;
+
+	if ((src1->width != src2->width) || (src1->width != dst->width) ||
+		(src1->height != src2->height) || (src1->height != dst->height)) return 0;
+
+	n = (long int)src1->wordsperline * src1->height;
+	for (i = 0; i < n; i++) dst->data[i] = src1->data[i] | src2->data[i];
+
+	return 1;
+}
+
+// Número de pixels a 1
+long int vc_packed_pixel_count(PVC* src)
+{
+	long int i, n, count = 0;
+
+	n = (long int)src->wordsperline * src->height;
+	for (i = 0; i < n; i++) count += vc_popcount64(src->data[i]);
+
+	return count;
+}
+
+// Percentagem de pixels a 1 (equivalente a vc_pixel_counter)
+int vc_packed_pixel_counter(PVC* src)
+{
+	long int count = vc_packed_pixel_count(src);
+	float percentage;
+
+	percentage = (count * 100) / ((long int)src->width * src->height);
+
+	return percentage;
+}
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        FUNÇÕES: MODELO DE FUNDO (DETEÇÃO DE MUDANÇAS)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Alocar um modelo de fundo vazio (o primeiro frame dado a vc_background_update inicializa a média)
+BVC *vc_background_new(int width, int height, int channels, int tile)
+{
+	BVC *bg;
+
+	if ((width <= 0) || (height <= 0) || (channels <= 0) || (tile <= 0)) return NULL;
+
+	bg = (BVC *)malloc(sizeof(BVC));
+	if (bg == NULL) return NULL;
+
+	bg->width = width;
+	bg->height = height;
+	bg->channels = channels;
+	bg->tile = tile;
+	bg->tilesx = (width + tile - 1) / tile;
+	bg->tilesy = (height + tile - 1) / tile;
+	bg->frames = 0;
+	bg->mean = (unsigned short *)malloc((size_t)width * height * channels * sizeof(unsigned short));
+	bg->changed = (unsigned char *)calloc((size_t)bg->tilesx * bg->tilesy, sizeof(unsigned char));
+
+	if ((bg->mean == NULL) || (bg->changed == NULL)) return vc_background_free(bg);
+
+	return bg;
+}
+
+BVC *vc_background_free(BVC *bg)
+{
+	if (bg != NULL)
+	{
+		free(bg->mean);
+		free(bg->changed);
+		free(bg);
+	}
+
+	return NULL;
+}
+
+// Uma só passagem: diferença para a média (só comparações e subtrações por canal) e atualização da média
+// Custa muito menos do que a conversão HSV, que só tem de ser feita nos blocos marcados
+int vc_background_update(IVC* src, BVC* bg, int threshold, int shift)
+{
+	int x, y, c, tx, ty, n, d, value, count = 0;
+	int rowbytes = bg->width * bg->channels;
+	unsigned char *pSrc, *flags;
+	unsigned short *pMean;
+
+	if ((src == NULL) || (bg == NULL) || (src->data == NULL)) return -1;
+	if ((src->width != bg->width) || (src->height != bg->height) || (src->channels != bg->channels)) return -1;
+
+	// Primeiro frame: a média é a própria imagem e todos os blocos "mudaram"
+	if (bg->frames == 0)
+	{
+		for (y = 0; y < bg->height; y++)
+		{
+			pSrc = &src->data[y * src->bytesperline];
+			pMean = &bg->mean[(long int)y * rowbytes];
+			for (x = 0; x < rowbytes; x++) pMean[x] = (unsigned short)(pSrc[x] << 8);
+		}
+		memset(bg->changed, 1, (size_t)bg->tilesx * bg->tilesy);
+		bg->frames = 1;
+
+		return bg->tilesx * bg->tilesy;
+	}
+
+	memset(bg->changed, 0, (size_t)bg->tilesx * bg->tilesy);
+
+	for (y = 0; y < bg->height; y++)
+	{
+		ty = y / bg->tile;
+		flags = &bg->changed[ty * bg->tilesx];
+		pSrc = &src->data[y * src->bytesperline];
+		pMean = &bg->mean[(long int)y * rowbytes];
+
+		for (tx = 0; tx < bg->tilesx; tx++)
+		{
+			x = tx * bg->tile * bg->channels;
+			n = (tx == bg->tilesx - 1) ? rowbytes : x + bg->tile * bg->channels;
+			d = 0;
+
+			for (c = x; c < n; c++)
+			{
+				value = pSrc[c] << 8;
+				if (abs(value - pMean[c]) > (threshold << 8)) d = 1;
+				pMean[c] = (unsigned short)(pMean[c] + ((value - pMean[c]) >> shift));
+			}
+			flags[tx] |= (unsigned char)d;
+		}
+	}
+
+	for (ty = 0; ty < bg->tilesx * bg->tilesy; ty++) count += bg->changed[ty];
+	bg->frames++;
+
+	return count;
+}
@@ -7,6 +7,8 @@
 //             [  DUARTE DUQUE - dduque@ipca.pt  ]
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+#ifndef VC_H
+#define VC_H
 
 #define VC_DEBUG
 #define MAX3(a,b,c) ((a) > (b) ? ((a) > (c) ? (a) : (c)) : ((b) > (c) ? (b) : (c)))
@@ -33,6 +35,8 @@ typedef struct {
 // FUNES: ALOCAR E LIBERTAR UMA IMAGEM
 IVC *vc_image_new(int width, int height, int channels, int levels);
 IVC *vc_image_free(IVC *image);
+int vc_image_view(IVC *view, unsigned char *data, int width, int height, int channels, int bytesperline);
+int vc_image_subsample(IVC *src, IVC *dst, int factor);
 
 // FUNES: LEITURA E ESCRITA DE IMAGENS (PBM, PGM E PPM)
 IVC *vc_read_image(char *filename);
@@ -41,9 +45,38 @@ int vc_write_image(char *filename, IVC *image);
 int vc_gray_negative(IVC* srcdst);
 
 int vc_rgb_to_hsv(IVC* src, IVC* dst);
+int vc_bgr_to_hsv(IVC* src, IVC* dst);
+int vc_rgb_to_gray(IVC* src, IVC* dst);
+int vc_bgr_to_gray(IVC* src, IVC* dst);
 
 int vc_hsv_segmentation(IVC* src, IVC* dst, int hmin, int hmax, int smin, int smax, int vmin, int vmax);
 
+// Intervalo HSV para segmentao (H em graus [0,360], S e V em % [0,100])
+typedef struct {
+	int hmin, hmax;
+	int smin, smax;
+	int vmin, vmax;
+} HVC;
+
+#define VC_MAX_HSV_RANGES 16
+
+// Converso RGB/BGR->HSV e segmentao por vrios intervalos numa s passagem (sem imagem HSV)
+int vc_rgb_hsv_segmentation_multi(IVC* src, IVC* dst, IVC* labels, const HVC* ranges, int nranges);
+int vc_bgr_hsv_segmentation_multi(IVC* src, IVC* dst, IVC* labels, const HVC* ranges, int nranges);
+
+// Tabela de classificao de cor: RGB quantizado -> classe (0 = fundo, 1..N = intervalo HSV)
+typedef struct {
+	unsigned char *table;	// (1 << (3 * bits)) entradas, ndice (r << 2*bits) | (g << bits) | b
+	int bits;				// Bits por canal (5 -> 32K entradas, 6 -> 256K entradas)
+} CVC;
+
+CVC *vc_colour_lut_new(const HVC* ranges, int nranges, int bits);
+CVC *vc_colour_lut_free(CVC *lut);
+int vc_rgb_lut_segmentation(IVC* src, IVC* dst, IVC* labels, const CVC* lut);
+int vc_bgr_lut_segmentation(IVC* src, IVC* dst, IVC* labels, const CVC* lut);
+long int vc_rgb_colour_lut_validate(IVC* src, const CVC* lut, const HVC* ranges, int nranges);
+long int vc_bgr_colour_lut_validate(IVC* src, const CVC* lut, const HVC* ranges, int nranges);
+
 int vc_scale_gray_to_color_pallette(IVC* src, IVC* dst);
 
 int vc_pixel_counter(IVC* src);
@@ -61,6 +94,32 @@ int vc_binary_erode(IVC* src, IVC* dst, int kernel);
 int vc_binary_open(IVC* src, IVC* dst, int kernel);
 int vc_binary_close(IVC* src, IVC* dst, int kernel);
 
+// Verses sem alocao: tmp  uma imagem auxiliar (1 canal) fornecida pelo chamador
+int vc_binary_open_tmp(IVC* src, IVC* dst, IVC* tmp, int kernel);
+int vc_binary_close_tmp(IVC* src, IVC* dst, IVC* tmp, int kernel);
+
+//Estrutura de trabalho da morfologia (reutilizada entre frames)
+
+#define VC_MORPH_SQUARE	0		// Elemento quadrado kernel x kernel
+#define VC_MORPH_DISK	1		// Elemento em disco de raio kernel / 2
+
+typedef struct {
+	unsigned char *row;			// Resultado da passagem horizontal (width * height)
+	unsigned char *acc;			// Acumulador do elemento em disco (width * height)
+	unsigned char *g, *h;		// Mximos por bloco do van Herk/Gil-Werman (crescem com o kernel)
+	long int size;				// Bytes alocados em g e h
+	int width, height;
+} MVC;
+
+MVC *vc_morph_new(int width, int height);
+MVC *vc_morph_free(MVC *ws);
+
+// Custo O(1) por pixel para o quadrado (passagens separveis) e O(kernel) para o disco
+int vc_binary_dilate_ws(IVC* src, IVC* dst, int kernel, int shape, MVC* ws);
+int vc_binary_erode_ws(IVC* src, IVC* dst, int kernel, int shape, MVC* ws);
+int vc_binary_open_ws(IVC* src, IVC* dst, IVC* tmp, int kernel, int shape, MVC* ws);
+int vc_binary_close_ws(IVC* src, IVC* dst, IVC* tmp, int kernel, int shape, MVC* ws);
+
 int vc_gray_to_binary2(IVC* src, IVC* dst, int treshold1, int treshold2);
 int vc_paint_brain(IVC* src, IVC* bin, IVC* dst);
 
@@ -76,8 +135,22 @@ typedef struct {
 	int xc, yc;					// Centro-de-massa
 	int perimeter;				// Permetro
 	int label;					// Etiqueta
+	float cx, cy;				// Centro-de-massa (subpixel)
+	float mu20, mu02, mu11;		// Momentos centrais de 2 ordem, normalizados pela rea
+	float meancolour[3];		// Cor mdia (ordem dos canais da imagem de cor; 0 se no houver)
+	float innercolour[3];		// Cor mdia do disco interior (distncia ao centro < VC_BLOB_INNER_RADIUS * raio)
+	float outercolour[3];		// Cor mdia do anel exterior (distncia ao centro >= VC_BLOB_OUTER_RADIUS * raio)
+	int innerarea, outerarea;	// Pixels do disco interior e do anel exterior
 } OVC;
 
+#define VC_BLOB_SUMS 8			// Somas por blob: x, y, x^2, y^2, xy e 3 canais de cor
+#define VC_BLOB_REGION_SUMS 8	// Somas da cor por blob: 3 canais + pixels, do disco interior e do anel exterior
+
+// Raios do disco interior e do anel exterior, em frao do raio do crculo com a rea do blob
+// (nas moedas bimetlicas o ncleo tem cerca de 0.7 do raio)
+#define VC_BLOB_INNER_RADIUS 0.5f
+#define VC_BLOB_OUTER_RADIUS 0.8f
+
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 
 //Funoes Blob
@@ -86,6 +159,89 @@ OVC* vc_binary_blob_labelling2(IVC* src, IVC* dst, int* nlabels);
 int vc_binary_blob_info(IVC* src, OVC* blobs, int nblobs);
 
 
+//Estrutura de trabalho da etiquetagem (reutilizada entre frames)
+
+typedef struct {
+	unsigned int *labels;		// Mapa de etiquetas (width * height)
+	int *labeltable;			// Equivalncias (union-find) das etiquetas provisrias
+	int maxlabels;				// Nmero mximo de etiquetas provisrias
+	OVC *blobs;					// Blobs do ltimo frame (pertencem ao workspace)
+	long long *sums;			// Somas dos momentos/cor (VC_BLOB_SUMS por blob)
+	int maxblobs;				// Capacidade dos arrays de blobs e de somas
+	int nblobs;					// Blobs da ltima etiquetagem (-1 se falhou ou ainda no foi feita)
+	int *strips;				// Faixas da etiquetagem paralela (y0, y1, 1 etiqueta, n de etiquetas)
+	int nstrips, maxstrips;
+	OVC *partial;				// Estatsticas parciais de cada faixa (nstrips * nblobs)
+	long long *partialsums;
+	long int maxpartial;
+	int width, height;
+} LVC;
+
+LVC *vc_labelling_new(int width, int height);
+LVC *vc_labelling_free(LVC *ws);
+
+// Igual a vc_binary_blob_labelling2, mas usa os buffers do workspace (no liberar o array devolvido)
+// Calcula todas as caractersticas dos blobs na mesma passagem; colour (opcional) d a cor mdia
+OVC* vc_binary_blob_labelling3(IVC* src, IVC* dst, IVC* colour, int* nlabels, LVC* ws);
+
+// Executor de tarefas: chama task(arg, i) para i = 0 .. n - 1 (em qualquer ordem e em paralelo)
+// e s retorna depois de todas terminarem
+typedef void (*VCTASK)(void *arg, int i);
+typedef void (*VCPARALLEL)(void *pool, int n, VCTASK task, void *arg);
+
+// Etiquetagem em nstrips faixas horizontais; parallel = NULL executa as faixas em srie
+OVC* vc_binary_blob_labelling_strips(IVC* src, IVC* dst, IVC* colour, int* nlabels, LVC* ws, int nstrips, VCPARALLEL parallel, void* pool);
+
+// Mapa de etiquetas (32 bits) da ltima etiquetagem, sem voltar a etiquetar
+const unsigned int* vc_labelling_labels(const LVC* ws);
+int vc_labelling_index(const LVC* ws, unsigned int label);
+int vc_labelling_map(const LVC* ws, unsigned int* dst, int stride, int index);
+int vc_labelling_blob_mask(const LVC* ws, const OVC* blob, IVC* dst);
+
+
 int vc_join_segmentations(IVC* src1, IVC* src2, IVC* dst);
 
 
+//Mscara binria compacta: 1 bit por pixel, 64 pixels por palavra
+
+typedef struct {
+	unsigned long long *data;	// Bit (x % 64) da palavra (x / 64) de cada linha; bits fora da imagem a 0
+	int width, height;
+	int wordsperline;			// (width + 63) / 64
+} PVC;
+
+PVC *vc_packed_new(int width, int height);
+PVC *vc_packed_free(PVC *mask);
+int vc_packed_from_binary(IVC* src, PVC* dst);
+int vc_packed_to_binary(PVC* src, IVC* dst);
+
+// Morfologia com elemento quadrado por deslocamentos e ORs de palavras (tmp: mscara auxiliar)
+int vc_packed_dilate(PVC* src, PVC* dst, PVC* tmp, int kernel);
+int vc_packed_erode(PVC* src, PVC* dst, PVC* tmp, int kernel);
+int vc_packed_open(PVC* src, PVC* dst, PVC* tmp, int kernel);
+int vc_packed_close(PVC* src, PVC* dst, PVC* tmp, int kernel);
+
+int vc_packed_join(PVC* src1, PVC* src2, PVC* dst);
+long int vc_packed_pixel_count(PVC* src);
+int vc_packed_pixel_counter(PVC* src);
+
+
+//Modelo de fundo: mdia mvel de cada pixel, para saber que blocos da imagem mudaram
+
+typedef struct {
+	unsigned short *mean;		// Mdia de cada canal em vrgula fixa 8.8 (width * height * channels)
+	unsigned char *changed;		// 1 nos blocos que mudaram na ltima atualizao (tilesx * tilesy)
+	int width, height, channels;
+	int tile;					// Lado dos blocos (pixels)
+	int tilesx, tilesy;
+	int frames;					// Frames acumulados (0 = modelo ainda vazio)
+} BVC;
+
+BVC *vc_background_new(int width, int height, int channels, int tile);
+BVC *vc_background_free(BVC *bg);
+
+// Marca os blocos com algum pixel a mais de threshold da mdia (num canal) e atualiza a mdia com peso
+// 1 / 2^shift; devolve o nmero de blocos que mudaram (todos, no primeiro frame)
+int vc_background_update(IVC* src, BVC* bg, int threshold, int shift);
+
+#endif
@@ -0,0 +1,1027 @@
+﻿//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITÉCNICO DO CÁVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMÁTICOS
+//           VISÃO POR COMPUTADOR - TRABALHO PRÁTICO
+//
+//                       [ GRUPO 26 ]
+//					 FICHEIRO - VC_SIMD.C
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Versões vetoriais (SSE2/SSE4.1/AVX2/NEON) dos kernels de pixel de vc.c.
+// O nível é escolhido pelo CPUID na primeira utilização; o código escalar de vc.c
+// continua a ser a referência (nível VC_SIMD_SCALAR) e trata o fim de cada linha.
+// Todas as versões dão exatamente o mesmo resultado que o código escalar:
+// as contas em vírgula flutuante seguem a mesma ordem de operações e os mesmos truncamentos.
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vc.h"
+#include "vc_simd.h"
+
+// Sem contração de multiplicações e somas em FMA (GCC com -march=native/-mfma, Clang, MSVC com
+// /fp:contract): o código escalar e os kernels vetoriais arredondam cada produto antes de somar,
+// para darem exatamente o mesmo resultado em qualquer compilador e CPU
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#if !defined(VC_NO_SIMD) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define VC_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif !defined(VC_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define VC_SIMD_ARM
+#include <arm_neon.h>
+#endif
+
+// No GCC/Clang cada função vetorial é compilada para o seu conjunto de instruções,
+// sem obrigar o resto do programa a exigir esse CPU; no MSVC os intrínsecos estão sempre disponíveis
+#if defined(__GNUC__)
+#define VC_TARGET_SSE2 __attribute__((target("sse2")))
+#define VC_TARGET_SSE41 __attribute__((target("ssse3,sse4.1")))
+#define VC_TARGET_AVX2 __attribute__((target("avx,avx2,ssse3,sse4.1")))
+#else
+#define VC_TARGET_SSE2
+#define VC_TARGET_SSE41
+#define VC_TARGET_AVX2
+#endif
+
+
+#if defined(VC_SIMD_X86) || defined(VC_SIMD_ARM)
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              LIMITES DE INTERVALOS EM BYTES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Limita [lo, hi] a [0, 255]; um intervalo vazio fica lo = 255, hi = 0 (nenhum byte satisfaz os dois)
+static void vc_simd_byte_range(int lo, int hi, unsigned char* blo, unsigned char* bhi)
+{
+	if (lo < 0) lo = 0;
+	if (hi > 255) hi = 255;
+	if (lo > hi)
+	{
+		lo = 255;
+		hi = 0;
+	}
+
+	*blo = (unsigned char)lo;
+	*bhi = (unsigned char)hi;
+}
+
+#endif
+
+
+#if defined(VC_SIMD_X86)
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    KERNELS SSE2 (16 PIXELS)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// lo <= v <= hi, sem comparações com sinal: max(v, lo) == v e min(v, hi) == v
+#define VC_SSE2_INRANGE(v, lo, hi) _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8((v), (lo)), (v)), _mm_cmpeq_epi8(_mm_min_epu8((v), (hi)), (v)))
+
+VC_TARGET_SSE2 static int vc_sse2_gray_negative(unsigned char* data, int n)
+{
+	const __m128i ones = _mm_set1_epi8((char)0xFF);
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + x));
+		_mm_storeu_si128((__m128i*)(data + x), _mm_xor_si128(v, ones));
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE2 static int vc_sse2_gray_inrange(const unsigned char* src, unsigned char* dst, int n, int lo, int hi)
+{
+	unsigned char blo, bhi;
+	__m128i vlo, vhi;
+	int x;
+
+	vc_simd_byte_range(lo, hi, &blo, &bhi);
+	vlo = _mm_set1_epi8((char)blo);
+	vhi = _mm_set1_epi8((char)bhi);
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+		_mm_storeu_si128((__m128i*)(dst + x), VC_SSE2_INRANGE(v, vlo, vhi));
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE2 static int vc_sse2_join(const unsigned char* src1, const unsigned char* src2, unsigned char* dst, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi8((char)0xFF);
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		__m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)(src1 + x)), _mm_loadu_si128((const __m128i*)(src2 + x)));
+		_mm_storeu_si128((__m128i*)(dst + x), _mm_xor_si128(_mm_cmpeq_epi8(v, zero), ones));
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE2 static int vc_sse2_pack(const unsigned char* src, unsigned long long* dst, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned long long zeros;
+	int x, i;
+
+	for (x = 0; x + 64 <= n; x += 64)
+	{
+		zeros = 0;
+		for (i = 0; i < 4; i++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + x + 16 * i));
+			zeros |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) << (16 * i);
+		}
+		dst[x / 64] = ~zeros;
+	}
+
+	return x;
+}
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              KERNELS SSE4.1 (16 PIXELS DE 3 CANAIS)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Máscaras pshufb para separar 16 pixels de 3 canais (48 bytes) em 3 vetores, e para os voltar a juntar
+static const signed char vc_deinterleave_mask[3][3][16] = {
+	{ { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+	{ { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+	{ { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } }
+};
+
+static const signed char vc_interleave_mask[3][3][16] = {
+	{ { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+	  { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+	  { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+	{ { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+	  { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+	  { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+	{ { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+	  { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+	  { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } }
+};
+
+#define VC_MASK(m) _mm_loadu_si128((const __m128i*)(m))
+
+// Separa 16 pixels (48 bytes) nos canais 0, 1 e 2
+VC_TARGET_SSE41 static __inline void vc_sse41_load3(const unsigned char* p, __m128i* c0, __m128i* c1, __m128i* c2)
+{
+	__m128i a = _mm_loadu_si128((const __m128i*)p);
+	__m128i b = _mm_loadu_si128((const __m128i*)(p + 16));
+	__m128i c = _mm_loadu_si128((const __m128i*)(p + 32));
+
+	*c0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, VC_MASK(vc_deinterleave_mask[0][0])), _mm_shuffle_epi8(b, VC_MASK(vc_deinterleave_mask[0][1]))), _mm_shuffle_epi8(c, VC_MASK(vc_deinterleave_mask[0][2])));
+	*c1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, VC_MASK(vc_deinterleave_mask[1][0])), _mm_shuffle_epi8(b, VC_MASK(vc_deinterleave_mask[1][1]))), _mm_shuffle_epi8(c, VC_MASK(vc_deinterleave_mask[1][2])));
+	*c2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, VC_MASK(vc_deinterleave_mask[2][0])), _mm_shuffle_epi8(b, VC_MASK(vc_deinterleave_mask[2][1]))), _mm_shuffle_epi8(c, VC_MASK(vc_deinterleave_mask[2][2])));
+}
+
+// Junta 3 canais de 16 pixels em 48 bytes
+VC_TARGET_SSE41 static __inline void vc_sse41_store3(unsigned char* p, __m128i c0, __m128i c1, __m128i c2)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, VC_MASK(vc_interleave_mask[i][0])), _mm_shuffle_epi8(c1, VC_MASK(vc_interleave_mask[i][1]))), _mm_shuffle_epi8(c2, VC_MASK(vc_interleave_mask[i][2])));
+		_mm_storeu_si128((__m128i*)(p + 16 * i), v);
+	}
+}
+
+// Lê 16 pixels RGB/BGR; ir = posição do canal R (0 ou 2)
+VC_TARGET_SSE41 static __inline void vc_sse41_load_rgb(const unsigned char* p, int ir, __m128i* r, __m128i* g, __m128i* b)
+{
+	__m128i c0, c2;
+
+	vc_sse41_load3(p, &c0, g, &c2);
+	*r = (ir == 0) ? c0 : c2;
+	*b = (ir == 0) ? c2 : c0;
+}
+
+// Junta 4 vetores de 4 inteiros (0..255) em 16 bytes
+VC_TARGET_SSE41 static __inline __m128i vc_sse41_pack4(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+// HSV de 4 pixels, com as mesmas operações (e pela mesma ordem) de vc_pixel_rgb_to_hsv
+VC_TARGET_SSE41 static __inline void vc_sse41_hsv4(__m128 rf, __m128 gf, __m128 bf, __m128i* h, __m128i* s)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 c60 = _mm_set1_ps(60.0f);
+	const __m128 c120 = _mm_set1_ps(120.0f);
+	const __m128 c240 = _mm_set1_ps(240.0f);
+	const __m128 c360 = _mm_set1_ps(360.0f);
+	const __m128 c255 = _mm_set1_ps(255.0f);
+	__m128 max, min, delta, valid, sat, hr, hg, hb, hue;
+
+	max = _mm_max_ps(rf, _mm_max_ps(gf, bf));
+	min = _mm_min_ps(rf, _mm_min_ps(gf, bf));
+	delta = _mm_sub_ps(max, min);
+
+	// max != min (implica max != 0); nos restantes pixels H = S = 0
+	valid = _mm_cmpgt_ps(delta, zero);
+
+	sat = _mm_and_ps(_mm_mul_ps(_mm_div_ps(delta, max), c255), valid);
+
+	hr = _mm_mul_ps(c60, _mm_div_ps(_mm_sub_ps(gf, bf), delta));
+	hr = _mm_blendv_ps(hr, _mm_add_ps(c360, hr), _mm_cmplt_ps(gf, bf));
+	hg = _mm_add_ps(c120, _mm_mul_ps(c60, _mm_div_ps(_mm_sub_ps(bf, rf), delta)));
+	hb = _mm_add_ps(c240, _mm_mul_ps(c60, _mm_div_ps(_mm_sub_ps(rf, gf), delta)));
+
+	// Prioridade igual à do código escalar: R, depois G, depois B
+	hue = _mm_blendv_ps(hb, hg, _mm_cmpeq_ps(max, gf));
+	hue = _mm_blendv_ps(hue, hr, _mm_cmpeq_ps(max, rf));
+	hue = _mm_and_ps(hue, valid);
+
+	*h = _mm_cvttps_epi32(_mm_mul_ps(_mm_div_ps(hue, c360), c255));
+	*s = _mm_cvttps_epi32(sat);
+}
+
+VC_TARGET_SSE41 static __inline void vc_sse41_hsv16(__m128i r, __m128i g, __m128i b, __m128i* h, __m128i* s, __m128i* v)
+{
+	__m128i hi[4], si[4];
+	int i;
+
+	*v = _mm_max_epu8(r, _mm_max_epu8(g, b));
+
+	for (i = 0; i < 4; i++)
+	{
+		vc_sse41_hsv4(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(r)), _mm_cvtepi32_ps(_mm_cvtepu8_epi32(g)), _mm_cvtepi32_ps(_mm_cvtepu8_epi32(b)), &hi[i], &si[i]);
+		r = _mm_srli_si128(r, 4);
+		g = _mm_srli_si128(g, 4);
+		b = _mm_srli_si128(b, 4);
+	}
+
+	*h = vc_sse41_pack4(hi[0], hi[1], hi[2], hi[3]);
+	*s = vc_sse41_pack4(si[0], si[1], si[2], si[3]);
+}
+
+// Cinzento de 4 pixels, em double como no código escalar ((r * 0.299) + (g * 0.587)) + (b * 0.114)
+VC_TARGET_SSE41 static __inline __m128i vc_sse41_gray4(__m128i r, __m128i g, __m128i b)
+{
+	const __m128d kr = _mm_set1_pd(0.299);
+	const __m128d kg = _mm_set1_pd(0.587);
+	const __m128d kb = _mm_set1_pd(0.114);
+	__m128i out[2];
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		__m128d y = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(r), kr), _mm_mul_pd(_mm_cvtepi32_pd(g), kg)), _mm_mul_pd(_mm_cvtepi32_pd(b), kb));
+		out[i] = _mm_cvttpd_epi32(y);
+		r = _mm_srli_si128(r, 8);
+		g = _mm_srli_si128(g, 8);
+		b = _mm_srli_si128(b, 8);
+	}
+
+	return _mm_unpacklo_epi64(out[0], out[1]);
+}
+
+// Limites (em bytes) de até VC_MAX_HSV_RANGES intervalos, prontos a comparar
+typedef struct {
+	__m128i lo[VC_MAX_HSV_RANGES][3];
+	__m128i hi[VC_MAX_HSV_RANGES][3];
+} VCSIMDRANGES;
+
+VC_TARGET_SSE41 static void vc_sse41_ranges(const int (*limits)[6], int nranges, VCSIMDRANGES* r)
+{
+	unsigned char lo, hi;
+	int k, c;
+
+	for (k = 0; k < nranges; k++)
+	{
+		for (c = 0; c < 3; c++)
+		{
+			vc_simd_byte_range(limits[k][2 * c], limits[k][2 * c + 1], &lo, &hi);
+			r->lo[k][c] = _mm_set1_epi8((char)lo);
+			r->hi[k][c] = _mm_set1_epi8((char)hi);
+		}
+	}
+}
+
+VC_TARGET_SSE41 static __inline __m128i vc_sse41_inrange3(__m128i h, __m128i s, __m128i v, const VCSIMDRANGES* r, int k)
+{
+	return _mm_and_si128(_mm_and_si128(VC_SSE2_INRANGE(h, r->lo[k][0], r->hi[k][0]), VC_SSE2_INRANGE(s, r->lo[k][1], r->hi[k][1])), VC_SSE2_INRANGE(v, r->lo[k][2], r->hi[k][2]));
+}
+
+// Máscara (0/255) e classe (índice+1 do primeiro intervalo que contém o pixel, ou 0) de 16 pixels HSV
+VC_TARGET_SSE41 static __inline void vc_sse41_classify16(__m128i h, __m128i s, __m128i v, const VCSIMDRANGES* r, int nranges, __m128i* mask, __m128i* label)
+{
+	__m128i found = _mm_setzero_si128();
+	__m128i cls = _mm_setzero_si128();
+	__m128i m;
+	int k;
+
+	for (k = 0; k < nranges; k++)
+	{
+		m = vc_sse41_inrange3(h, s, v, r, k);
+		cls = _mm_or_si128(cls, _mm_and_si128(_mm_andnot_si128(found, m), _mm_set1_epi8((char)(k + 1))));
+		found = _mm_or_si128(found, m);
+	}
+
+	*mask = found;
+	*label = cls;
+}
+
+// Expande 64 bits para 64 bytes (0/255): cada byte de bits é replicado 8 vezes e testado bit a bit
+VC_TARGET_SSE41 static int vc_sse41_unpack(const unsigned long long* src, unsigned char* dst, int n)
+{
+	const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+	unsigned long long word;
+	__m128i v;
+	int x, i;
+
+	for (x = 0; x + 64 <= n; x += 64)
+	{
+		word = src[x / 64];
+		for (i = 0; i < 4; i++)
+		{
+			v = _mm_shuffle_epi8(_mm_cvtsi32_si128((int)((word >> (16 * i)) & 0xFFFF)), spread);
+			_mm_storeu_si128((__m128i*)(dst + x + 16 * i), _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits));
+		}
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE41 static int vc_sse41_rgb_to_gray(const unsigned char* src, unsigned char* dst, int n, int ir, int ib)
+{
+	__m128i r, g, b, y[4];
+	int x, i;
+
+	(void)ib;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+
+		for (i = 0; i < 4; i++)
+		{
+			y[i] = vc_sse41_gray4(_mm_cvtepu8_epi32(r), _mm_cvtepu8_epi32(g), _mm_cvtepu8_epi32(b));
+			r = _mm_srli_si128(r, 4);
+			g = _mm_srli_si128(g, 4);
+			b = _mm_srli_si128(b, 4);
+		}
+
+		_mm_storeu_si128((__m128i*)(dst + x), vc_sse41_pack4(y[0], y[1], y[2], y[3]));
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE41 static int vc_sse41_rgb_to_hsv(const unsigned char* src, unsigned char* dst, int n, int ir, int ib)
+{
+	__m128i r, g, b, h, s, v;
+	int x;
+
+	(void)ib;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+		vc_sse41_hsv16(r, g, b, &h, &s, &v);
+		vc_sse41_store3(dst + 3 * x, h, s, v);
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE41 static int vc_sse41_hsv_inrange(const unsigned char* src, unsigned char* dst, int n, const int* limits)
+{
+	VCSIMDRANGES r;
+	__m128i h, s, v;
+	int x;
+
+	vc_sse41_ranges((const int (*)[6])limits, 1, &r);
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load3(src + 3 * x, &h, &s, &v);
+		_mm_storeu_si128((__m128i*)(dst + x), vc_sse41_inrange3(h, s, v, &r, 0));
+	}
+
+	return x;
+}
+
+VC_TARGET_SSE41 static int vc_sse41_rgb_hsv_class(const unsigned char* src, unsigned char* dst, unsigned char* labels, int n, int ir, int ib, const int (*limits)[6], int nranges)
+{
+	VCSIMDRANGES ranges;
+	__m128i r, g, b, h, s, v, mask, label;
+	int x;
+
+	(void)ib;
+	vc_sse41_ranges(limits, nranges, &ranges);
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+		vc_sse41_hsv16(r, g, b, &h, &s, &v);
+		vc_sse41_classify16(h, s, v, &ranges, nranges, &mask, &label);
+
+		_mm_storeu_si128((__m128i*)(dst + x), mask);
+		if (labels != NULL) _mm_storeu_si128((__m128i*)(labels + x), label);
+	}
+
+	return x;
+}
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                         KERNELS AVX2
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_AVX2_INRANGE(v, lo, hi) _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8((v), (lo)), (v)), _mm256_cmpeq_epi8(_mm256_min_epu8((v), (hi)), (v)))
+
+VC_TARGET_AVX2 static int vc_avx2_gray_negative(unsigned char* data, int n)
+{
+	const __m256i ones = _mm256_set1_epi8((char)0xFF);
+	int x;
+
+	for (x = 0; x + 32 <= n; x += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data + x));
+		_mm256_storeu_si256((__m256i*)(data + x), _mm256_xor_si256(v, ones));
+	}
+
+	return x;
+}
+
+VC_TARGET_AVX2 static int vc_avx2_gray_inrange(const unsigned char* src, unsigned char* dst, int n, int lo, int hi)
+{
+	unsigned char blo, bhi;
+	__m256i vlo, vhi;
+	int x;
+
+	vc_simd_byte_range(lo, hi, &blo, &bhi);
+	vlo = _mm256_set1_epi8((char)blo);
+	vhi = _mm256_set1_epi8((char)bhi);
+
+	for (x = 0; x + 32 <= n; x += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + x));
+		_mm256_storeu_si256((__m256i*)(dst + x), VC_AVX2_INRANGE(v, vlo, vhi));
+	}
+
+	return x;
+}
+
+VC_TARGET_AVX2 static int vc_avx2_join(const unsigned char* src1, const unsigned char* src2, unsigned char* dst, int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi8((char)0xFF);
+	int x;
+
+	for (x = 0; x + 32 <= n; x += 32)
+	{
+		__m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(src1 + x)), _mm256_loadu_si256((const __m256i*)(src2 + x)));
+		_mm256_storeu_si256((__m256i*)(dst + x), _mm256_xor_si256(_mm256_cmpeq_epi8(v, zero), ones));
+	}
+
+	return x;
+}
+
+VC_TARGET_AVX2 static int vc_avx2_pack(const unsigned char* src, unsigned long long* dst, int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned long long lo, hi;
+	int x;
+
+	for (x = 0; x + 64 <= n; x += 64)
+	{
+		lo = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(src + x)), zero));
+		hi = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(src + x + 32)), zero));
+		dst[x / 64] = ~(lo | (hi << 32));
+	}
+
+	return x;
+}
+
+// HSV de 8 pixels (ver vc_sse41_hsv4)
+VC_TARGET_AVX2 static __inline void vc_avx2_hsv8(__m256 rf, __m256 gf, __m256 bf, __m128i* h, __m128i* s)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 c60 = _mm256_set1_ps(60.0f);
+	const __m256 c120 = _mm256_set1_ps(120.0f);
+	const __m256 c240 = _mm256_set1_ps(240.0f);
+	const __m256 c360 = _mm256_set1_ps(360.0f);
+	const __m256 c255 = _mm256_set1_ps(255.0f);
+	__m256 max, min, delta, valid, sat, hr, hg, hb, hue;
+	__m256i hi, si;
+
+	max = _mm256_max_ps(rf, _mm256_max_ps(gf, bf));
+	min = _mm256_min_ps(rf, _mm256_min_ps(gf, bf));
+	delta = _mm256_sub_ps(max, min);
+	valid = _mm256_cmp_ps(delta, zero, _CMP_GT_OQ);
+
+	sat = _mm256_and_ps(_mm256_mul_ps(_mm256_div_ps(delta, max), c255), valid);
+
+	hr = _mm256_mul_ps(c60, _mm256_div_ps(_mm256_sub_ps(gf, bf), delta));
+	hr = _mm256_blendv_ps(hr, _mm256_add_ps(c360, hr), _mm256_cmp_ps(gf, bf, _CMP_LT_OQ));
+	hg = _mm256_add_ps(c120, _mm256_mul_ps(c60, _mm256_div_ps(_mm256_sub_ps(bf, rf), delta)));
+	hb = _mm256_add_ps(c240, _mm256_mul_ps(c60, _mm256_div_ps(_mm256_sub_ps(rf, gf), delta)));
+
+	hue = _mm256_blendv_ps(hb, hg, _mm256_cmp_ps(max, gf, _CMP_EQ_OQ));
+	hue = _mm256_blendv_ps(hue, hr, _mm256_cmp_ps(max, rf, _CMP_EQ_OQ));
+	hue = _mm256_and_ps(hue, valid);
+
+	hi = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_div_ps(hue, c360), c255));
+	si = _mm256_cvttps_epi32(sat);
+
+	h[0] = _mm256_castsi256_si128(hi);
+	h[1] = _mm256_extracti128_si256(hi, 1);
+	s[0] = _mm256_castsi256_si128(si);
+	s[1] = _mm256_extracti128_si256(si, 1);
+}
+
+VC_TARGET_AVX2 static __inline void vc_avx2_hsv16(__m128i r, __m128i g, __m128i b, __m128i* h, __m128i* s, __m128i* v)
+{
+	__m128i hi[4], si[4];
+
+	*v = _mm_max_epu8(r, _mm_max_epu8(g, b));
+
+	vc_avx2_hsv8(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(r)), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(g)), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b)), &hi[0], &si[0]);
+	r = _mm_srli_si128(r, 8);
+	g = _mm_srli_si128(g, 8);
+	b = _mm_srli_si128(b, 8);
+	vc_avx2_hsv8(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(r)), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(g)), _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b)), &hi[2], &si[2]);
+
+	*h = vc_sse41_pack4(hi[0], hi[1], hi[2], hi[3]);
+	*s = vc_sse41_pack4(si[0], si[1], si[2], si[3]);
+}
+
+VC_TARGET_AVX2 static int vc_avx2_rgb_to_gray(const unsigned char* src, unsigned char* dst, int n, int ir, int ib)
+{
+	const __m256d kr = _mm256_set1_pd(0.299);
+	const __m256d kg = _mm256_set1_pd(0.587);
+	const __m256d kb = _mm256_set1_pd(0.114);
+	__m128i r, g, b, y[4];
+	__m256d yd;
+	int x, i;
+
+	(void)ib;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+
+		for (i = 0; i < 4; i++)
+		{
+			yd = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepu8_epi32(r)), kr), _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepu8_epi32(g)), kg)), _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepu8_epi32(b)), kb));
+			y[i] = _mm256_cvttpd_epi32(yd);
+			r = _mm_srli_si128(r, 4);
+			g = _mm_srli_si128(g, 4);
+			b = _mm_srli_si128(b, 4);
+		}
+
+		_mm_storeu_si128((__m128i*)(dst + x), vc_sse41_pack4(y[0], y[1], y[2], y[3]));
+	}
+
+	return x;
+}
+
+VC_TARGET_AVX2 static int vc_avx2_rgb_to_hsv(const unsigned char* src, unsigned char* dst, int n, int ir, int ib)
+{
+	__m128i r, g, b, h, s, v;
+	int x;
+
+	(void)ib;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+		vc_avx2_hsv16(r, g, b, &h, &s, &v);
+		vc_sse41_store3(dst + 3 * x, h, s, v);
+	}
+
+	return x;
+}
+
+VC_TARGET_AVX2 static int vc_avx2_rgb_hsv_class(const unsigned char* src, unsigned char* dst, unsigned char* labels, int n, int ir, int ib, const int (*limits)[6], int nranges)
+{
+	VCSIMDRANGES ranges;
+	__m128i r, g, b, h, s, v, mask, label;
+	int x;
+
+	(void)ib;
+	vc_sse41_ranges(limits, nranges, &ranges);
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vc_sse41_load_rgb(src + 3 * x, ir, &r, &g, &b);
+		vc_avx2_hsv16(r, g, b, &h, &s, &v);
+		vc_sse41_classify16(h, s, v, &ranges, nranges, &mask, &label);
+
+		_mm_storeu_si128((__m128i*)(dst + x), mask);
+		if (labels != NULL) _mm_storeu_si128((__m128i*)(labels + x), label);
+	}
+
+	return x;
+}
+
+#endif // VC_SIMD_X86
+
+
+#if defined(VC_SIMD_ARM)
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    KERNELS NEON (16 PIXELS)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+static int vc_neon_gray_negative(unsigned char* data, int n)
+{
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		vst1q_u8(data + x, vmvnq_u8(vld1q_u8(data + x)));
+	}
+
+	return x;
+}
+
+static int vc_neon_gray_inrange(const unsigned char* src, unsigned char* dst, int n, int lo, int hi)
+{
+	unsigned char blo, bhi;
+	uint8x16_t vlo, vhi, v;
+	int x;
+
+	vc_simd_byte_range(lo, hi, &blo, &bhi);
+	vlo = vdupq_n_u8(blo);
+	vhi = vdupq_n_u8(bhi);
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		v = vld1q_u8(src + x);
+		vst1q_u8(dst + x, vandq_u8(vcgeq_u8(v, vlo), vcleq_u8(v, vhi)));
+	}
+
+	return x;
+}
+
+static int vc_neon_join(const unsigned char* src1, const unsigned char* src2, unsigned char* dst, int n)
+{
+	uint8x16_t v;
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		v = vorrq_u8(vld1q_u8(src1 + x), vld1q_u8(src2 + x));
+		vst1q_u8(dst + x, vtstq_u8(v, v));
+	}
+
+	return x;
+}
+
+static int vc_neon_hsv_inrange(const unsigned char* src, unsigned char* dst, int n, const int* limits)
+{
+	uint8x16_t lo[3], hi[3], m;
+	uint8x16x3_t p;
+	unsigned char blo, bhi;
+	int x, c;
+
+	for (c = 0; c < 3; c++)
+	{
+		vc_simd_byte_range(limits[2 * c], limits[2 * c + 1], &blo, &bhi);
+		lo[c] = vdupq_n_u8(blo);
+		hi[c] = vdupq_n_u8(bhi);
+	}
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		p = vld3q_u8(src + 3 * x);
+		m = vandq_u8(vcgeq_u8(p.val[0], lo[0]), vcleq_u8(p.val[0], hi[0]));
+		m = vandq_u8(m, vandq_u8(vcgeq_u8(p.val[1], lo[1]), vcleq_u8(p.val[1], hi[1])));
+		m = vandq_u8(m, vandq_u8(vcgeq_u8(p.val[2], lo[2]), vcleq_u8(p.val[2], hi[2])));
+		vst1q_u8(dst + x, m);
+	}
+
+	return x;
+}
+
+#endif // VC_SIMD_ARM
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                  TABELAS DE KERNELS E DISPATCH
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+static const VCSIMD vc_simd_scalar = { VC_SIMD_SCALAR, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+#if defined(VC_SIMD_X86)
+static const VCSIMD vc_simd_sse2 = { VC_SIMD_SSE2, vc_sse2_gray_negative, vc_sse2_gray_inrange, vc_sse2_join, NULL, NULL, NULL, NULL, vc_sse2_pack, NULL };
+static const VCSIMD vc_simd_sse41 = { VC_SIMD_SSE41, vc_sse2_gray_negative, vc_sse2_gray_inrange, vc_sse2_join, vc_sse41_rgb_to_gray, vc_sse41_rgb_to_hsv, vc_sse41_hsv_inrange, vc_sse41_rgb_hsv_class, vc_sse2_pack, vc_sse41_unpack };
+static const VCSIMD vc_simd_avx2 = { VC_SIMD_AVX2, vc_avx2_gray_negative, vc_avx2_gray_inrange, vc_avx2_join, vc_avx2_rgb_to_gray, vc_avx2_rgb_to_hsv, vc_sse41_hsv_inrange, vc_avx2_rgb_hsv_class, vc_avx2_pack, vc_sse41_unpack };
+#endif
+
+#if defined(VC_SIMD_ARM)
+static const VCSIMD vc_simd_neon = { VC_SIMD_NEON, vc_neon_gray_negative, vc_neon_gray_inrange, vc_neon_join, NULL, NULL, vc_neon_hsv_inrange, NULL, NULL, NULL };
+#endif
+
+static const VCSIMD* vc_simd_active = NULL;
+static int vc_simd_detected = -1;
+
+int vc_simd_detect(void)
+{
+	int level = VC_SIMD_SCALAR;
+
+	if (vc_simd_detected >= 0) return vc_simd_detected;
+
+#if defined(VC_SIMD_X86)
+#if defined(_MSC_VER)
+	{
+		int info[4];
+		int sse2, ssse3, sse41, osxsave, avx, avx2 = 0;
+
+		__cpuid(info, 1);
+		sse2 = (info[3] >> 26) & 1;
+		ssse3 = (info[2] >> 9) & 1;
+		sse41 = (info[2] >> 19) & 1;
+		osxsave = (info[2] >> 27) & 1;
+		avx = (info[2] >> 28) & 1;
+
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] >> 5) & 1;
+		}
+
+		// O sistema operativo tem de guardar os registos YMM (XCR0 bits 1 e 2)
+		if (!(osxsave && avx && ((_xgetbv(0) & 6) == 6))) avx2 = 0;
+
+		if (sse2) level = VC_SIMD_SSE2;
+		if (sse2 && ssse3 && sse41) level = VC_SIMD_SSE41;
+		if (level == VC_SIMD_SSE41 && avx2) level = VC_SIMD_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) level = VC_SIMD_SSE2;
+	if (level == VC_SIMD_SSE2 && __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")) level = VC_SIMD_SSE41;
+	if (level == VC_SIMD_SSE41 && __builtin_cpu_supports("avx2")) level = VC_SIMD_AVX2;
+#endif
+#elif defined(VC_SIMD_ARM)
+	// NEON faz parte do AArch64 (e foi pedido ao compilador em ARMv7)
+	level = VC_SIMD_NEON;
+#endif
+
+	vc_simd_detected = level;
+	return level;
+}
+
+static const VCSIMD* vc_simd_table(int level)
+{
+	switch (level)
+	{
+#if defined(VC_SIMD_X86)
+	case VC_SIMD_SSE2: return &vc_simd_sse2;
+	case VC_SIMD_SSE41: return &vc_simd_sse41;
+	case VC_SIMD_AVX2: return &vc_simd_avx2;
+#endif
+#if defined(VC_SIMD_ARM)
+	case VC_SIMD_NEON: return &vc_simd_neon;
+#endif
+	default: return &vc_simd_scalar;
+	}
+}
+
+const VCSIMD *vc_simd(void)
+{
+	if (vc_simd_active == NULL) vc_simd_active = vc_simd_table(vc_simd_detect());
+
+	return vc_simd_active;
+}
+
+int vc_simd_level(void)
+{
+	return vc_simd()->level;
+}
+
+int vc_simd_set_level(int level)
+{
+	int best = vc_simd_detect();
+
+	// Não é possível ativar instruções que este CPU (ou esta arquitetura) não tem
+	if (level != VC_SIMD_SCALAR)
+	{
+		if ((best == VC_SIMD_NEON) != (level == VC_SIMD_NEON)) level = best;
+		else if (level > best) level = best;
+	}
+
+	vc_simd_active = vc_simd_table(level);
+
+	return vc_simd_active->level;
+}
+
+const char *vc_simd_name(int level)
+{
+	switch (level)
+	{
+	case VC_SIMD_SCALAR: return "escalar";
+	case VC_SIMD_SSE2: return "SSE2";
+	case VC_SIMD_SSE41: return "SSE4.1";
+	case VC_SIMD_AVX2: return "AVX2";
+	case VC_SIMD_NEON: return "NEON";
+	default: return "?";
+	}
+}
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              TESTE: VETORIAL == ESCALAR, BIT A BIT
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Executa o caso de teste i sobre as imagens de entrada; devolve o nome do caso, ou NULL se já não houver mais
+// out1 (1 canal), out3 (3 canais) e labels recebem os resultados a comparar
+static const char *vc_simd_selftest_case(int i, IVC* rgb, IVC* view, IVC* gray, IVC* gray2, IVC* out1, IVC* out3, IVC* labels)
+{
+	static const int thresholds[] = { -1, 0, 1, 100, 254, 255, 300 };
+	static const int thresholds2[][2] = { { -5, 300 }, { 50, 200 }, { 100, 101 }, { 100, 102 }, { 200, 50 } };
+	static const HVC ranges[] = {
+		{ 20, 40, 30, 100, 10, 50 },
+		{ 43, 72, 19, 70, 7, 64 },
+		{ 50, 150, 1, 25, 10, 55 },
+		{ 0, 360, 0, 100, 0, 100 }
+	};
+	const int nthresholds = sizeof(thresholds) / sizeof(thresholds[0]);
+	const int nthresholds2 = sizeof(thresholds2) / sizeof(thresholds2[0]);
+	const int nranges = sizeof(ranges) / sizeof(ranges[0]);
+	IVC out3view, out1view;
+	PVC* packed;
+
+	if (i == 0)
+	{
+		memcpy(out1->data, gray->data, gray->bytesperline * gray->height);
+		vc_gray_negative(out1);
+		return "vc_gray_negative";
+	}
+	i -= 1;
+
+	if (i < nthresholds)
+	{
+		vc_gray_to_binary(gray, out1, thresholds[i]);
+		return "vc_gray_to_binary";
+	}
+	i -= nthresholds;
+
+	if (i < nthresholds2)
+	{
+		vc_gray_to_binary2(gray, out1, thresholds2[i][0], thresholds2[i][1]);
+		return "vc_gray_to_binary2";
+	}
+	i -= nthresholds2;
+
+	if (i < nranges)
+	{
+		vc_hsv_segmentation(rgb, out1, ranges[i].hmin, ranges[i].hmax, ranges[i].smin, ranges[i].smax, ranges[i].vmin, ranges[i].vmax);
+		return "vc_hsv_segmentation";
+	}
+	i -= nranges;
+
+	// Vistas com bytesperline maior que width * channels
+	vc_image_view(&out1view, out1->data, view->width, view->height, 1, out1->bytesperline);
+	vc_image_view(&out3view, out3->data, view->width, view->height, 3, out3->bytesperline);
+
+	switch (i)
+	{
+	case 0: vc_gray_to_binary_global_mean(gray, out1); return "vc_gray_to_binary_global_mean";
+	case 1: vc_join_segmentations(gray, gray2, out1); return "vc_join_segmentations";
+	case 2: vc_rgb_to_gray(rgb, out1); return "vc_rgb_to_gray";
+	case 3: vc_bgr_to_gray(rgb, out1); return "vc_bgr_to_gray";
+	case 4: vc_bgr_to_gray(view, &out1view); return "vc_bgr_to_gray (vista)";
+	case 5: vc_rgb_to_hsv(rgb, out3); return "vc_rgb_to_hsv";
+	case 6: vc_bgr_to_hsv(rgb, out3); return "vc_bgr_to_hsv";
+	case 7: vc_bgr_to_hsv(view, &out3view); return "vc_bgr_to_hsv (vista)";
+	case 8: vc_rgb_hsv_segmentation_multi(rgb, out1, labels, ranges, 3); return "vc_rgb_hsv_segmentation_multi";
+	case 9: vc_bgr_hsv_segmentation_multi(rgb, out1, labels, ranges, nranges); return "vc_bgr_hsv_segmentation_multi";
+	case 10: vc_bgr_hsv_segmentation_multi(rgb, out1, NULL, ranges + 1, 1); return "vc_bgr_hsv_segmentation_multi";
+	case 11:
+		// Compactar e expandir (a largura não é múltipla de 64)
+		packed = vc_packed_new(gray->width, gray->height);
+		if (packed == NULL) return "vc_packed_new";
+		vc_packed_from_binary(gray, packed);
+		vc_packed_to_binary(packed, out1);
+		vc_packed_free(packed);
+		return "vc_packed_from_binary/vc_packed_to_binary";
+	default: return NULL;
+	}
+}
+
+int vc_simd_selftest(void)
+{
+	// Largura que não é múltipla de 16/32, para exercitar o fim de linha escalar
+	const int width = 1001, height = 67;
+	static const unsigned char edges[] = { 0, 1, 2, 127, 128, 254, 255 };
+	int saved = vc_simd_level();
+	int best = vc_simd_detect();
+	int failures = 0;
+	int level, first, i, k;
+	unsigned int seed = 12345;
+	unsigned char* p;
+	const char* name;
+	IVC* rgb, * gray, * gray2, * ref[3], * cur[3];
+	IVC view;
+
+	rgb = vc_image_new(width, height, 3, 255);
+	gray = vc_image_new(width, height, 1, 255);
+	gray2 = vc_image_new(width, height, 1, 255);
+	ref[0] = vc_image_new(width, height, 1, 255);
+	ref[1] = vc_image_new(width, height, 3, 255);
+	ref[2] = vc_image_new(width, height, 1, 255);
+	cur[0] = vc_image_new(width, height, 1, 255);
+	cur[1] = vc_image_new(width, height, 3, 255);
+	cur[2] = vc_image_new(width, height, 1, 255);
+
+	if (!rgb || !gray || !gray2 || !ref[0] || !ref[1] || !ref[2] || !cur[0] || !cur[1] || !cur[2])
+	{
+		failures = 1;
+	}
+	else
+	{
+		// Pixels aleatórios; uma em cada 4 linhas só usa valores de fronteira (empates entre canais, 0, 255)
+		for (i = 0; i < width * height * 3; i++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			rgb->data[i] = ((i / (width * 3)) % 4 == 0) ? edges[(seed >> 16) % sizeof(edges)] : (unsigned char)(seed >> 16);
+		}
+		for (i = 0; i < width * height; i++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			gray->data[i] = ((seed >> 13) & 3) ? (unsigned char)(seed >> 16) : 0;
+			gray2->data[i] = ((seed >> 11) & 3) ? 0 : (unsigned char)(seed >> 24);
+		}
+		vc_image_view(&view, rgb->data + 3 * 5, width - 11, height - 2, 3, rgb->bytesperline);
+
+		first = (best == VC_SIMD_NEON) ? VC_SIMD_NEON : VC_SIMD_SSE2;
+
+		for (level = first; level <= best; level++)
+		{
+			for (i = 0; ; i++)
+			{
+				for (k = 0; k < 3; k++)
+				{
+					memset(ref[k]->data, 0x5A, ref[k]->bytesperline * height);
+					memset(cur[k]->data, 0x5A, cur[k]->bytesperline * height);
+				}
+
+				vc_simd_set_level(VC_SIMD_SCALAR);
+				name = vc_simd_selftest_case(i, rgb, &view, gray, gray2, ref[0], ref[1], ref[2]);
+				if (name == NULL) break;
+
+				vc_simd_set_level(level);
+				vc_simd_selftest_case(i, rgb, &view, gray, gray2, cur[0], cur[1], cur[2]);
+
+				for (k = 0; k < 3; k++)
+				{
+					if (memcmp(ref[k]->data, cur[k]->data, ref[k]->bytesperline * height) != 0)
+					{
+						for (p = cur[k]->data; *p == ref[k]->data[p - cur[k]->data]; p++);
+						printf("vc_simd_selftest(): %s difere em %s (caso %d, byte %ld)\n", vc_simd_name(level), name, i, (long)(p - cur[k]->data));
+						failures++;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	vc_image_free(rgb);
+	vc_image_free(gray);
+	vc_image_free(gray2);
+	for (k = 0; k < 3; k++)
+	{
+		vc_image_free(ref[k]);
+		vc_image_free(cur[k]);
+	}
+
+	vc_simd_set_level(saved);
+
+	return failures;
+}
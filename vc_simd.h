@@ -0,0 +1,73 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           INSTITUTO POLITCNICO DO CVADO E DO AVE
+//                          2024/2025
+//             ENGENHARIA DE SISTEMAS INFORMTICOS
+//           VISO POR COMPUTADOR - TRABALHO PRTICO
+//
+//                       [ GRUPO 26 ]
+//					 FICHEIRO - VC_SIMD.H
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifndef VC_SIMD_H
+#define VC_SIMD_H
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              NVEIS DE INSTRUES VETORIAIS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_SIMD_SCALAR	0		// Cdigo escalar de vc.c (referncia)
+#define VC_SIMD_SSE2	1
+#define VC_SIMD_SSE41	2		// SSE4.1 (inclui SSSE3)
+#define VC_SIMD_AVX2	3
+#define VC_SIMD_NEON	4
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              KERNELS DE LINHA (USADOS POR VC.C)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Cada kernel processa os primeiros pixels de uma linha e devolve quantos processou
+// (um mltiplo da largura do vetor); o resto da linha fica para o cdigo escalar.
+// Um ponteiro a NULL indica que a operao no est vetorizada no nvel ativo.
+typedef struct {
+	int level;
+
+	// data = 255 - data (1 canal)
+	int (*gray_negative)(unsigned char *data, int n);
+
+	// dst = (lo <= src <= hi) ? 255 : 0, com 0 <= lo, hi <= 255 (lo > hi: intervalo vazio)
+	int (*gray_inrange)(const unsigned char *src, unsigned char *dst, int n, int lo, int hi);
+
+	// dst = (src1 != 0 || src2 != 0) ? 255 : 0
+	int (*join)(const unsigned char *src1, const unsigned char *src2, unsigned char *dst, int n);
+
+	// RGB/BGR (3 canais) -> cinzento; ir, ib = posio dos canais R e B
+	int (*rgb_to_gray)(const unsigned char *src, unsigned char *dst, int n, int ir, int ib);
+
+	// RGB/BGR (3 canais) -> HSV (3 canais), igual a vc_rgb_to_hsv bit a bit
+	int (*rgb_to_hsv)(const unsigned char *src, unsigned char *dst, int n, int ir, int ib);
+
+	// HSV (3 canais) -> mscara; limits = {hlo, hhi, slo, shi, vlo, vhi} j em [0, 255]
+	int (*hsv_inrange)(const unsigned char *src, unsigned char *dst, int n, const int *limits);
+
+	// RGB/BGR -> mscara e classe (opcional) por vrios intervalos, como a segmentao fundida
+	int (*rgb_hsv_class)(const unsigned char *src, unsigned char *dst, unsigned char *labels, int n, int ir, int ib, const int (*limits)[6], int nranges);
+
+	// Mscara compacta: bit (x % 64) da palavra (x / 64) = (src[x] != 0), e o inverso (bit ? 255 : 0)
+	int (*pack)(const unsigned char *src, unsigned long long *dst, int n);
+	int (*unpack)(const unsigned long long *src, unsigned char *dst, int n);
+} VCSIMD;
+
+// Kernels do nvel ativo (detetado pelo CPUID na primeira chamada)
+// A primeira chamada (e vc_simd_set_level) deve ser feita antes de usar vc.c em vrias threads
+const VCSIMD *vc_simd(void);
+
+int vc_simd_detect(void);				// Melhor nvel suportado por este CPU
+int vc_simd_level(void);				// Nvel ativo
+int vc_simd_set_level(int level);		// Fora um nvel (limitado ao detetado); devolve o nvel ativo
+const char *vc_simd_name(int level);
+
+// Compara, bit a bit, as verses vetoriais com as escalares em imagens de teste
+// Devolve o nmero de kernels com diferenas (0 = tudo igual)
+int vc_simd_selftest(void);
+
+#endif